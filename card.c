@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////
+////                             CARD.C                                ////
+////            Card family routing by ATQA and SAK                    ////
+////                                                                   ////
+////  card_atqa(atqa)  Families a card may belong to, from the ATQA    ////
+////                   returned by MFRC522_isCard().  0 means the      ////
+////                   card is not supported and can be dropped        ////
+////                   before anticollision and select.                ////
+////                                                                   ////
+////  card_sak(sak)    Families allowed by the SAK from select.        ////
+////                                                                   ////
+////  The result is a mask of CARD_xxx routes.  CARD_UID cards can be  ////
+////  matched on their 4 byte uid alone.  Only the families in         ////
+////  CARD_ROUTES are returned: NTAG and ISO-DEP cards are recognised  ////
+////  but have no authenticated credential check yet, so they are      ////
+////  dropped.                                                         ////
+///////////////////////////////////////////////////////////////////////////
+
+#define CARD_UID        0x01     // 4 byte uid lists
+#define CARD_CLASSIC    0x02     // MIFARE Classic sector credential
+#define CARD_NTAG       0x04     // NTAG21x / Ultralight pages
+#define CARD_ISODEP     0x08     // ISO14443-4 application (DESFire, phones)
+
+// A phone can answer a SELECT with anything, so ISO-DEP stays off until
+// it has a challenge-response (a MAC over a reader nonce, or DESFire AES).
+// NTAG pages are plaintext anyone can write to a blank tag, so NTAG stays
+// off until the pages are authenticated (PWD_AUTH with a password derived
+// per tag, or a MAC as prov.c uses) and the user is checked in cred.c.
+#ifndef CARD_ROUTES
+   #define CARD_ROUTES  (CARD_UID|CARD_CLASSIC)
+#endif
+
+typedef struct
+{
+   BYTE value;
+   BYTE mask;
+   BYTE route;
+} CARD_MAP;
+
+// keyed on ATQA byte 0; byte 1 splits DESFire (0x03) from NTAG (0x00)
+CARD_MAP const CARD_BY_ATQA[4] = {
+   {0x04, 0xFF, CARD_UID|CARD_CLASSIC|CARD_ISODEP},  // 1K, Mini, phones
+   {0x02, 0xFF, CARD_UID|CARD_CLASSIC},              // Classic 4K
+   {0x44, 0xFF, CARD_NTAG|CARD_ISODEP},              // NTAG, DESFire
+   {0x08, 0xFF, CARD_ISODEP}                         // random uid (phones)
+};
+
+CARD_MAP const CARD_BY_SAK[5] = {
+   {0x08, 0xFF, CARD_UID|CARD_CLASSIC},              // Classic 1K
+   {0x18, 0xFF, CARD_UID|CARD_CLASSIC},              // Classic 4K
+   {0x09, 0xFF, CARD_UID|CARD_CLASSIC},              // Classic Mini
+   {0x00, 0xFF, CARD_NTAG},                          // Ultralight, NTAG
+   {0x20, 0x20, CARD_ISODEP}                         // ISO14443-4 compliant
+};
+
+BYTE card_atqa(char atqa[])
+{
+   BYTE i;
+
+   for(i=0;i<4;++i)
+   {
+      if((atqa[0] & CARD_BY_ATQA[i].mask) != CARD_BY_ATQA[i].value)
+         continue;
+      if(atqa[0] == 0x44)
+         return(CARD_BY_ATQA[i].route & CARD_ROUTES &
+                ((atqa[1] == 0x03) ? CARD_ISODEP : CARD_NTAG));
+      if(atqa[1] != 0x00)
+         break;
+      return(CARD_BY_ATQA[i].route & CARD_ROUTES);
+   }
+   return(0);
+}
+
+BYTE card_sak(BYTE sak)
+{
+   BYTE i;
+
+   for(i=0;i<5;++i)
+      if((sak & CARD_BY_SAK[i].mask) == CARD_BY_SAK[i].value)
+         return(CARD_BY_SAK[i].route);
+   return(0);
+}
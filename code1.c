@@ -1,7 +1,11 @@
 
+#ifdef __PCM__
 #INCLUDE <16F887.H>
 #USE DELAY(CLOCK=20M)
 #FUSES PUT,HS,NOWDT,NOPROTECT,NOLVP
+#else
+#include <compat.h>                 // XC8
+#endif
 
 #define LCD_ENABLE_PIN     PIN_D5            
 #define LCD_RS_PIN         PIN_D7                                                   
@@ -10,6 +14,7 @@
 #define LCD_DATA5          PIN_C7                                    
 #define LCD_DATA6          PIN_C6                                                      
 #define LCD_DATA7          PIN_C5   
+//#define LCD_SCRUB                   // repair the screen from a RAM copy
 #include <lcd.c> 
 
 
@@ -20,12 +25,87 @@
 #define MFRC522_RST        PIN_C3    
 #include<Built_in.h>
 
+//#define TURNSTILE_MODE           // one strike pulse per tap, taps queued
+#define TS_SHOW_MS         1500     // turnstile greeting stays on screen
+//#define WIEGAND_OUT        34       // copy every uid read to a panel (26/34)
+//#define WIEGAND_IN                  // accept badges from a Wiegand reader
+//#define INTERLOCK                   // airlock: doors 0 and 1 never open together
+//#define RTC_CLOCK                   // DS1307/DS3231 on A1/A2, SQW on B0
+//#define PROV_CARD                   // accept signed admin provisioning cards
+//#define OV_DEBUG                    // check ownership of the overlay arena
+//#define ISR_STATS                   // measure interrupt latency and run time
+//#define MARK_PIN           PIN_D1   // logic analyzer markers, see ladecode.py
+//#define UTF8_NAMES                  // show UTF-8 names with utf8_putc()
+//#define UTF8_CGRAM                  // ... keeping Vietnamese letter shapes
+
+#ifdef MARK_PIN
+// n pulses of about 1us: 1 = card seen, 2 = decision made
+#define MARK(n)   { BYTE m_; for(m_=0;m_<(n);++m_) { output_high(MARK_PIN); \
+                    delay_cycles(4); output_low(MARK_PIN); delay_cycles(4); } }
+#else
+#define MARK(n)
+#endif
+
+#ifdef __PCM__
+#priority rb, rtcc, timer2, ext     // Wiegand edges before the tick
+#elif defined(TURNSTILE_MODE) || defined(WIEGAND_OUT) || defined(WIEGAND_IN) \
+   || defined(INTERLOCK) || defined(RTC_CLOCK) || defined(PROV_CARD)
+#error This feature still needs the CCS compiler
+#endif
+
+#include <isr_stat.c>
+#ifdef PROV_CARD
+#define CRED_STAGE   7              // one admin card's worth of badges
+#endif
+#include <overlay.c>
+
+#include <msg.c>
+#ifdef UTF8_NAMES
+#include <utf8.c>
+#endif
+#include <cred.c>
+#include <mifare.c>
+#ifdef PROV_CARD
+#include <prov.c>
+#endif
+#include <rc522io.c>
+#include <ntag.c>
+#include <isodep.c>
+#include <card.c>
+#include <tick.c>
+#ifdef INTERLOCK
+#define DOOR_HOLDS   {5000, 5000}
+#endif
+#include <door.c>
+#ifdef TURNSTILE_MODE
+#include <turnstile.c>
+#endif
+#ifdef WIEGAND_OUT
+#include <wiegand.c>
+#endif
+#ifdef WIEGAND_IN
+#include <wiegand_in.c>
+#endif
+#ifdef INTERLOCK
+#include <interlock.c>
+#endif
+#ifdef RTC_CLOCK
+#include <rtc.c>
+#endif
+
 char DATA_TRUNG[4] ={0XD3, 0X4D, 0XFC, 0X27 };
 char DATA_HUY[4]   ={0X73, 0X9F, 0X6F, 0X13};
 
 
-int1 THE_1=0, TAM = 0, i;
-char tt_1, tt_2;
+int1 THE_1=0, i;
+int1 VE_LAI = 1;                    // scan prompt must be redrawn
+int16 LUC_VE, GIU_VE = 0;           // from when, and after how many ms
+BYTE UID_LEN;                       // uid bytes read by DOC_THE, 0 if none
+BYTE CUA;                           // doors the last accepted badge opens
+
+#define THE_SAI   0xFF     // card read but not enrolled
+#define THE_LOI   0xFE     // card left the field or the read failed
+#define THE_CAP   0xFD     // provisioning card applied
 
 
 int1 QUET_THE(char DATA[],char UID[])
@@ -48,98 +128,276 @@ int1 QUET_THE(char DATA[],char UID[])
 void bipbip(unsigned int8 hoi,unsigned int8 tieng) 
 { 
    unsigned int8 i, j;
-   for(i = 0; i < hoi; i ++){
-      for(j = 0; j < tieng; j ++){
-         output_high(pin_c0);
+   for(i = 0; i < hoi; i ++){      // @wcet 10
+      for(j = 0; j < tieng; j ++){  // @wcet 10
+         output_high(PIN_C0);
          delay_ms(1);
       }
-      output_low(pin_c0);
+      output_low(PIN_C0);
       delay_ms(10);
    }
 }
 
+#ifdef __PCM__
+#int_timer2
+#endif
+void NGAT_TIMER2(void)
+{
+   ISR_ENTER();
+   ISR_WAIT(ISR_TIMER2, (int16)get_timer2()*4);   // 0.8us Timer2 counts since the match
+   tick_isr();
+   door_isr();
+#ifdef INTERLOCK
+   il_isr();
+#endif
+#ifdef TURNSTILE_MODE
+   ts_isr();
+#endif
+   ISR_LEAVE(ISR_TIMER2);
+}
+
+#ifndef __PCM__
+// XC8 has the one vector; poll the sources in the #priority order
+void __interrupt() NGAT(void)
+{
+   if(PIE1bits.TMR2IE && PIR1bits.TMR2IF)
+   {
+      PIR1bits.TMR2IF = 0;
+      NGAT_TIMER2();
+   }
+}
+#endif
+
+void VE_SAU(int16 giu)
+{
+   VE_LAI = 1;
+   LUC_VE = tick_now();
+   GIU_VE = giu;
+}
+
+void MO_CUA(BYTE ten)
+{
+   msg_puts(ten);
+   lcd_gotoxy(0,2);
+#ifdef TURNSTILE_MODE
+   if(ts_grant())
+   {
+      msg_puts(MSG_WELCOME);
+      bipbip(1,3);
+   }
+   else                                // TS_QUEUE people already let in
+   {
+      lcd_gotoxy(4,2);
+      msg_puts(MSG_WARNING);
+      bipbip(10,10);
+   }
+   VE_SAU(TS_SHOW_MS);
+   return;
+#endif
+#ifdef INTERLOCK
+   if(il_request(CUA))
+   {
+      msg_puts(MSG_WELCOME);
+      bipbip(1,3);
+   }
+   else                                // IL_QUEUE already waiting
+   {
+      lcd_gotoxy(4,2);
+      msg_puts(MSG_WARNING);
+      bipbip(10,10);
+   }
+   VE_SAU(TS_SHOW_MS);
+   return;
+#endif
+   door_grant(CUA);
+   if(door_shut)                       // a toggling door was open
+      msg_puts(MSG_CLOSED);
+   else
+      msg_puts(MSG_WELCOME);
+   bipbip(3,3);
+   delay_ms(1000);
+   VE_SAU(0);
+}
+
+// Match a 4 byte uid against the built-in users and the flash store.
+// Returns the name message, or THE_SAI.  CUA receives the doors.
+BYTE TIM_UID(char UID[])
+{
+   BYTE user;
+
+   CUA = DOOR_DEFAULT;                 // built-in users
+   if(QUET_THE(DATA_TRUNG,UID))
+      return(MSG_TRUNG);
+   if(QUET_THE(DATA_HUY,UID))
+      return(MSG_HUY);
+   if(cred_find(UID, &user))
+   {
+      CUA = door_mask(user);
+      return(MSG_MEMBER);
+   }
+   return(THE_SAI);
+}
+
+void XU_LY(BYTE the)
+{
+   if(the == THE_CAP)
+   {
+      msg_puts(MSG_PROV);
+      bipbip(2,3);
+      VE_SAU(TS_SHOW_MS);
+   }
+   else if(the == THE_SAI || (the != THE_LOI && CUA == 0))
+   {
+      lcd_gotoxy(0, 1);
+      msg_puts(MSG_INVALID);
+      lcd_gotoxy(4, 2);
+      msg_puts(MSG_WARNING);
+      bipbip(10,10);
+      VE_SAU(0);
+   } 
+   else if(the != THE_LOI)
+   {
+      MO_CUA(the);
+   }
+}
+
+// Decide on the card in the field and return the name message to greet
+// it with.  The ATQA picks the shortest path for the card family, and
+// unsupported cards are dropped before anticollision or select.  The
+// uid lists and the flash bucket are searched while the level 1 select
+// frame is still on air, so the answer is ready with the SAK.
+BYTE DOC_THE(char TagType[], char UID[])
+{
+   BYTE route, sak, pos, user, the = THE_SAI;
+
+   UID_LEN = 0;
+   route = card_atqa(TagType);
+   if(route == 0)
+      return(THE_SAI);
+
+   pos = rc522_level(0x93, UID, 0);
+   if(pos == RC_FAIL)
+      return(THE_LOI);
+   UID_LEN = pos;
+   if(route & CARD_UID)
+      the = TIM_UID(UID);
+   sak = rc522_sak();
+   if(the != THE_SAI || route == CARD_UID)
+      return(the);
+   if(sak == RC_FAIL)
+      return(THE_LOI);
+
+   if(sak & 0x04)                      // 7 byte uid, cascade level 2
+   {
+      UID_LEN = rc522_level(0x95, UID, pos);
+      if(UID_LEN == RC_FAIL)
+      {
+         UID_LEN = 0;
+         return(THE_LOI);
+      }
+      sak = rc522_sak();
+      if(sak == RC_FAIL)
+         return(THE_LOI);
+   }
+   route &= card_sak(sak);
+   if((route & CARD_CLASSIC) && mf_cred(UID, &user))
+   {
+      // an admin card opens nothing, it only carries provisioning
+      if(user == MF_ADMIN)
+#ifdef PROV_CARD
+         return(prov_card(UID) ? THE_CAP : THE_SAI);
+#else
+         return(THE_SAI);
+#endif
+   }
+   else if(!((route & CARD_NTAG) && ntag_cred(UID, &user)))
+      return(THE_SAI);
+   CUA = door_mask(user);
+   return(MSG_MEMBER);
+}
+
 void main()
 {
 
-   CHAR UID[6];
-   UNSIGNED int TagType;                
-   lcd_init ();
+   char UID[8];
+   char TagType[2];                
+   BYTE the;
+#ifdef LCD_SCRUB
+   int16 LUC_SOAT = 0;              // tick of the last screen check
+#endif
+   setup_adc_ports(NO_ANALOGS);
+   if(!lcd_init())                  // no display: lcd_fault is set, the
+      bipbip(2,200);                // doors work, two long beeps say so
+#ifdef UTF8_NAMES
+   utf8_init();
+#endif
    lcd_gotoxy(0,1);
-   printf (LCD_PUTC, "HE THONG MO CUA");
+   msg_puts(MSG_TITLE);
    lcd_gotoxy(6,2);
-   printf (LCD_PUTC, "NHOM 10");
+   msg_puts(MSG_GROUP);
    delay_ms(3000);
-   printf (LCD_PUTC, "\f  Initializing"); 
+   msg_puts(MSG_INIT);
    MFRC522_Init ();
+   mf_init();
+   cred_init();
+   isr_stat_init();
+   tick_init();
+   door_init();
+#ifdef WIEGAND_OUT
+   wg_init();
+#endif
+#ifdef WIEGAND_IN
+   wgi_init();
+#endif
+#ifdef INTERLOCK
+   il_init();
+#endif
+#ifdef RTC_CLOCK
+   rtc_init();
+#endif
+   enable_interrupts(GLOBAL);
    delay_ms(100);
-   printf (LCD_PUTC, "\n*****Done!******"); 
+   msg_puts(MSG_DONE);
    delay_ms(1000);
-   WHILE (true)
+   while(TRUE)
    {
-      printf (LCD_PUTC,"\fXin moi quet the");
-      IF (MFRC522_isCard (&TagType)) //Check any card
+      if(VE_LAI && tick_since(LUC_VE) >= GIU_VE)
+      {
+         msg_puts(MSG_SCAN);
+         VE_LAI = 0;
+      }
+      if(MFRC522_isCard(TagType)) //Check any card
       {                                           
-         //Read ID 
-         IF (MFRC522_ReadCardSerial (&UID))             
-         {
-            tt_1 = QUET_THE(DATA_TRUNG,UID);
-            tt_2 = QUET_THE(DATA_HUY,UID);
-           
-            if( tt_1 == 1)
-            { 
-               if(TAM == 0){
-                  printf(LCD_PUTC, "\f Thanh Trung ");
-                  lcd_gotoxy(0,2);
-                  printf(LCD_PUTC, "xin moi ban vao");
-                  bipbip(3,3);
-                  delay_ms(100);
-                  output_High(PIN_c1);
-                  
-               }
-               else if(TAM == 1){
-                  printf(LCD_PUTC, "\f Thanh Trung ");
-                  lcd_gotoxy(0,2);
-                  printf(LCD_PUTC, "Cua da duoc dong");
-                  bipbip(3,3);
-                  delay_ms(100);
-                  output_low(PIN_c1);
-               }
-               TAM =~ TAM;
-               delay_ms(1000);
-            } 
-            else if(tt_2 == 1){
-               if(TAM == 0){
-                  printf(LCD_PUTC, "\f    Thanh Huy    ");
-                  lcd_gotoxy(0,2);
-                  printf(LCD_PUTC, "xin moi ban vao");
-                  bipbip(3,3);
-                  delay_ms(100);
-                  output_High(PIN_c1);
-               
-               }
-               else if(TAM == 1){
-                  printf(LCD_PUTC, "\f    Thanh Huy    ");
-                  lcd_gotoxy(0,2);
-                  printf(LCD_PUTC, "Cua da duoc dong");
-                  bipbip(3,3);
-                  delay_ms(100);
-                  output_low(PIN_c1);
-                  }
-                  TAM =~ TAM;
-                  delay_ms(1000);
-            }
-            
-            else
-            {
-               lcd_gotoxy(0, 1);
-               printf (LCD_PUTC, "The khong hop le");
-               lcd_gotoxy(4, 2);
-               printf (LCD_PUTC, "WARNING!!!");
-               bipbip(10,10);
-            } 
-         }                                      
+         MARK(1);
+         the = DOC_THE(TagType, UID);
+         MARK(2);
+#ifdef WIEGAND_OUT
+         if(UID_LEN >= 4)
+            wg_send(UID, WIEGAND_OUT);
+#endif
+         XU_LY(the);
          
         MFRC522_Halt () ;
+        mf_end();
       }    
+#ifdef WIEGAND_IN
+      if(wgi_frame(UID))
+      {
+         MARK(1);
+         the = TIM_UID(UID);
+         MARK(2);
+         XU_LY(the);
+      }
+#endif
+#ifdef RTC_CLOCK
+      rtc_poll();
+#endif
+#ifdef LCD_SCRUB
+      if(tick_now() != LUC_SOAT)
+      {
+         LUC_SOAT = tick_now();
+         lcd_scrub();
+      }
+#endif
    }
 }
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////
+////                             COMPAT.H                              ////
+////          CCS built-ins for a build with Microchip XC8             ////
+////                                                                   ////
+////  code1.c includes this instead of <16F887.H> when __PCM__ (the    ////
+////  CCS PCM compiler) is not defined.  It maps the types, pin        ////
+////  numbers and built-in functions the default build uses onto XC8   ////
+////  and the PIC16F887 registers; the CCS directives in the sources   ////
+////  are guarded with #ifdef __PCM__ where they appear.               ////
+////                                                                   ////
+////  Build with                                                       ////
+////     xc8-cc -mcpu=16F887 -I. -mreserve=rom@0x1800:0x1FFF code1.c   ////
+////  The reserve keeps the linker out of the credential region that   ////
+////  #org holds under CCS.                                            ////
+////                                                                   ////
+////  Only the default build is covered.  The turnstile, Wiegand,      ////
+////  interlock, RTC and provisioning modules still use CCS            ////
+////  directives and are refused by code1.c.  Built_in.h (the MFRC522  ////
+////  library) must build with the built-ins below.                    ////
+////                                                                   ////
+////  test/t_xc8.sh checks this build with gcc against stand-in        ////
+////  headers.                                                         ////
+///////////////////////////////////////////////////////////////////////////
+
+#include <xc.h>
+
+#pragma config FOSC=HS, WDTE=OFF, PWRTE=ON, CP=OFF, LVP=OFF
+
+#define _XTAL_FREQ      20000000
+
+// CCS integers are unsigned; int is 8 bits there and is left alone
+#define BYTE            unsigned char
+#define int1            unsigned char
+#define int8            char
+#define int16           unsigned int
+#define int32           unsigned long
+#define BOOLEAN         unsigned char  // LCD_PIN_MAP, unused with LCD pins
+#define TRUE            1
+#define FALSE           0
+
+// pin = register address * 8 + bit, as in the CCS device header
+#define PIN_A0  40
+#define PIN_A1  41
+#define PIN_A2  42
+#define PIN_A3  43
+#define PIN_A4  44
+#define PIN_A5  45
+#define PIN_A6  46
+#define PIN_A7  47
+#define PIN_B0  48
+#define PIN_B1  49
+#define PIN_B2  50
+#define PIN_B3  51
+#define PIN_B4  52
+#define PIN_B5  53
+#define PIN_B6  54
+#define PIN_B7  55
+#define PIN_C0  56
+#define PIN_C1  57
+#define PIN_C2  58
+#define PIN_C3  59
+#define PIN_C4  60
+#define PIN_C5  61
+#define PIN_C6  62
+#define PIN_C7  63
+#define PIN_D0  64
+#define PIN_D1  65
+#define PIN_D2  66
+#define PIN_D3  67
+#define PIN_D4  68
+#define PIN_D5  69
+#define PIN_D6  70
+#define PIN_D7  71
+#define PIN_E0  72
+#define PIN_E1  73
+#define PIN_E2  74
+#define PIN_E3  75
+
+#define CCS_PORT(p)     (*(volatile unsigned char *)((p) >> 3))
+#define CCS_TRIS(p)     (*(volatile unsigned char *)(((p) >> 3) + 0x80))
+#define CCS_MASK(p)     (1 << ((p) & 7))
+
+#define output_drive(p) (CCS_TRIS(p) &= ~CCS_MASK(p))
+#define output_float(p) (CCS_TRIS(p) |= CCS_MASK(p))
+#define output_high(p)  do { output_drive(p); CCS_PORT(p) |= CCS_MASK(p); } while(0)
+#define output_low(p)   do { output_drive(p); CCS_PORT(p) &= ~CCS_MASK(p); } while(0)
+#define output_bit(p,v) do { if(v) output_high(p); else output_low(p); } while(0)
+#define input(p)        (output_float(p), (CCS_PORT(p) & CCS_MASK(p)) != 0)
+
+#define delay_us(n)     __delay_us(n)          // constant n only
+#define delay_cycles(n) _delay(n)
+
+void delay_ms(unsigned int n)
+{
+   while(n--)
+      __delay_ms(1);
+}
+
+#define bit_test(x,b)   (((x) >> (b)) & 1)
+#define make8(x,n)      ((BYTE)((x) >> (8*(n))))
+#define make16(h,l)     (((int16)(h) << 8) | (BYTE)(l))
+#define make32(a,b,c,d) (((int32)make16(a,b) << 16) | make16(c,d))
+
+#define read_eeprom(a)     eeprom_read(a)
+#define write_eeprom(a,v)  eeprom_write(a,v)
+
+// interrupts: enable_interrupts(INT_TIMER2) expands to INT_TIMER2_ON
+#define enable_interrupts(i)  i##_ON
+#define disable_interrupts(i) i##_OFF
+#define GLOBAL_ON             (INTCONbits.PEIE = 1, INTCONbits.GIE = 1)
+#define GLOBAL_OFF            (INTCONbits.GIE = 0)
+#define INT_TIMER2_ON         (PIE1bits.TMR2IE = 1)
+#define INT_TIMER2_OFF        (PIE1bits.TMR2IE = 0)
+
+#define T2_DISABLED     0x00
+#define T2_DIV_BY_1     0x04           // TMR2ON | prescale
+#define T2_DIV_BY_4     0x05
+#define T2_DIV_BY_16    0x06
+#define setup_timer_2(m,p,s)  (PR2 = (p), T2CON = (m) | (((s)-1) << 3))
+#define get_timer2()          TMR2
+
+#define T1_INTERNAL     0x01           // TMR1ON, Fosc/4
+#define T1_DIV_BY_1     0x00
+#define setup_timer_1(m)      (T1CON = (m))
+
+// TMR1L can carry into TMR1H between the two reads; read again if it did
+int16 get_timer1(void)
+{
+   BYTE h, l;
+
+   do
+   {
+      h = TMR1H;
+      l = TMR1L;
+   } while(h != TMR1H);
+   return(make16(h, l));
+}
+
+#define NO_ANALOGS      0
+#define setup_adc_ports(x)    (ANSEL = (x), ANSELH = (x))
+
+// program memory, low byte first as read_program_memory() gives it
+#ifndef CRED_ROW
+   #define CRED_ROW     16             // 16F887 row, two write blocks
+#endif
+
+int16 read_program_eeprom(int16 a)
+{
+   EEADRH = make8(a,1);
+   EEADR = make8(a,0);
+   EECON1bits.EEPGD = 1;
+   EECON1bits.RD = 1;
+   NOP();
+   NOP();
+   return(make16(EEDATH, EEDAT));
+}
+
+void read_program_memory(int16 a, BYTE *p, BYTE n)
+{
+   int16 w;
+
+   for(; n; n-=2, ++a)
+   {
+      w = read_program_eeprom(a);
+      *p++ = make8(w,0);
+      *p++ = make8(w,1);
+   }
+}
+
+// Each word goes to the block latches; the block is erased and written
+// when its last word (address bits 2:0 = 111) is written.
+void write_program_memory(int16 a, BYTE *p, BYTE n)
+{
+   BYTE gie;
+
+   for(; n; n-=2, ++a)
+   {
+      EEADRH = make8(a,1);
+      EEADR = make8(a,0);
+      EEDAT = *p++;
+      EEDATH = *p++;
+      EECON1bits.EEPGD = 1;
+      EECON1bits.WREN = 1;
+      gie = INTCONbits.GIE;
+      INTCONbits.GIE = 0;
+      EECON2 = 0x55;
+      EECON2 = 0xAA;
+      EECON1bits.WR = 1;
+      NOP();
+      NOP();
+      INTCONbits.GIE = gie;
+      EECON1bits.WREN = 0;
+   }
+}
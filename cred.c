@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////////////
+////                             CRED.C                                ////
+////            Badge credential store in program flash                ////
+////                                                                   ////
+////  cred_init()               Pick the bank to read.  Call once at   ////
+////                            start-up.                              ////
+////                                                                   ////
+////  cred_find(uid,&user)      TRUE if the 4 byte uid is enrolled,    ////
+////                            user receives its user number.         ////
+////                                                                   ////
+////  cred_stage_add(uid,user)  Queue an add or update.  FALSE when    ////
+////  cred_stage_del(uid)       the stage is full; call cred_sync().   ////
+////                            The stage is in the overlay arena;     ////
+////                            hold OV_STAGE while it is in use.      ////
+////                                                                   ////
+////  cred_sync()               Write all staged changes to the idle   ////
+////                            bank and switch to it.  FALSE if an    ////
+////                            add found no free slot; the live bank  ////
+////                            is kept then and no change is made.    ////
+////                                                                   ////
+////  The store is an open addressed hash table over flash rows (one   ////
+////  erase block each).  A badge lives in its home row, picked by     ////
+////  the uid, or in one of the next CRED_PROBE rows.  Each record is  ////
+////  4 program words: the low byte of word n holds uid[n] and the     ////
+////  upper 6 bits hold the user number (word 0), so below CRED_USERS, ////
+////  and the slot state (word 3).  Erased flash (0x3FFF) reads as an  ////
+////  empty slot.                                                      ////
+////                                                                   ////
+////  The region holds two banks, each a whole table.  Lookups read    ////
+////  the live bank only.  A sync first brings the idle bank level     ////
+////  with the live one, writing only the rows that differ (those the  ////
+////  previous sync changed), applies the stage to it, and records     ////
+////  its generation and CRC in data EEPROM.  The switch is the one    ////
+////  byte CRED_EE_BANK, so a power loss at any point leaves one       ////
+////  complete bank; cred_init() falls back to the other bank when     ////
+////  the selected one fails its CRC.                                  ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef CRED_BASE
+   #define CRED_BASE    0x1800      // first word of the reserved region
+   #define CRED_END     0x1FFF
+#endif
+#ifndef CRED_ROW
+   #define CRED_ROW     (getenv("FLASH_ERASE_SIZE")/2)   // words per row
+#endif
+#ifndef CRED_EE_BANK
+   #define CRED_EE_BANK 0x20        // live bank, 0 or 1
+   #define CRED_EE_HDR  0x21        // per bank: generation(2) CRC(2)
+#endif
+#ifndef CRED_PROBE
+   #define CRED_PROBE   8           // rows searched past the home row
+#endif
+
+#define CRED_BANK    ((CRED_END+1-CRED_BASE)/2)         // words per bank
+#define CRED_ROWS    (CRED_BANK/CRED_ROW)               // power of two
+#define CRED_SLOTS   (CRED_ROW/4)                        // records per row
+
+#define CRED_USERS   64             // user numbers the 6 bits hold
+#define CRED_EMPTY   0x3F           // erased flash
+#define CRED_LIVE    0x01
+#define CRED_DEAD    0x00           // deleted, keeps probe chains intact
+#define CRED_DELETE  0xFF           // staged user number for a removal
+
+#ifdef __PCM__
+#org CRED_BASE, CRED_END {}         // XC8: -mreserve, see compat.h
+#endif
+
+#define CRED_UID(s,i)   cred_row[((s)<<3)+((i)<<1)]
+#define CRED_USER(s)    cred_row[((s)<<3)+1]
+#define CRED_STATE(s)   cred_row[((s)<<3)+7]
+
+typedef struct
+{
+   char uid[4];
+   BYTE user;                       // CRED_DELETE to remove the badge
+} CRED_OP;
+
+BYTE cred_row[CRED_ROW*2];          // one flash row, 2 bytes per word
+BYTE cred_cur;                      // row held in cred_row
+BYTE cred_live = 0;                 // bank lookups read
+int16 cred_at = CRED_BASE;          // bank cred_row is loaded from
+int1 cred_valid = 0, cred_dirty = 0;
+BYTE cred_slot;                     // slot found by cred_search()
+BYTE cred_free_row, cred_free_slot; // first reusable slot on the way
+int1 cred_has_free;
+
+// the stage lives in the overlay arena, see overlay.c
+#define cred_stage   ((CRED_OP *)&ov_arena[OV_STAGE_AT])
+BYTE cred_staged = 0;
+
+void cred_flush(void)
+{
+   if(cred_dirty)
+   {
+      // write_program_memory erases the row first when it starts a block
+      write_program_memory(cred_at+(int16)cred_cur*CRED_ROW, cred_row,
+                           CRED_ROW*2);
+      cred_dirty = 0;
+   }
+}
+
+void cred_load(BYTE row)
+{
+   if(cred_valid && row == cred_cur)
+      return;
+   cred_flush();
+   read_program_memory(cred_at+(int16)row*CRED_ROW, cred_row, CRED_ROW*2);
+   cred_cur = row;
+   cred_valid = 1;
+}
+
+BYTE cred_home(char uid[])
+{
+   return((uid[0]^uid[1]^uid[2]^uid[3]) & (CRED_ROWS-1));
+}
+
+// Probe from the home row.  Returns TRUE with the row loaded and cred_slot
+// set when uid is stored.  Stops at the first empty slot.
+int1 cred_search(char uid[])
+{
+   BYTE row, n, s;
+
+   cred_has_free = 0;
+   row = cred_home(uid);
+   for(n=0;n<=CRED_PROBE;++n)
+   {
+      cred_load(row);
+      for(s=0;s<CRED_SLOTS;++s)
+      {
+         if(CRED_STATE(s) == CRED_LIVE)
+         {
+            if(CRED_UID(s,0) == uid[0] && CRED_UID(s,1) == uid[1] &&
+               CRED_UID(s,2) == uid[2] && CRED_UID(s,3) == uid[3])
+            {
+               cred_slot = s;
+               return(TRUE);
+            }
+            continue;
+         }
+         if(!cred_has_free)
+         {
+            cred_has_free = 1;
+            cred_free_row = row;
+            cred_free_slot = s;
+         }
+         if(CRED_STATE(s) != CRED_DEAD)
+            return(FALSE);
+      }
+      row = (row+1) & (CRED_ROWS-1);
+   }
+   return(FALSE);
+}
+
+int1 cred_find(char uid[], BYTE *user)
+{
+   if(!cred_search(uid))
+      return(FALSE);
+   *user = CRED_USER(cred_slot);
+   return(TRUE);
+}
+
+int1 cred_stage_add(char uid[], BYTE user)
+{
+   BYTE i;
+
+   if(cred_staged >= CRED_STAGE)
+      return(FALSE);
+   OV_CHECK(OV_STAGE);
+   for(i=0;i<4;++i)
+      cred_stage[cred_staged].uid[i] = uid[i];
+   cred_stage[cred_staged].user = user;
+   ++cred_staged;
+   return(TRUE);
+}
+
+int1 cred_stage_del(char uid[])
+{
+   return(cred_stage_add(uid, CRED_DELETE));
+}
+
+int16 cred_crc(int16 crc, BYTE b)  // CRC-16/CCITT
+{
+   BYTE x;
+
+   x = make8(crc,1) ^ b;
+   x ^= x >> 4;
+   return((crc << 8) ^ ((int16)x << 12) ^ ((int16)x << 5) ^ x);
+}
+
+int16 cred_bank_crc(BYTE bank)
+{
+   int16 crc = 0xFFFF;
+   BYTE row, i;
+
+   cred_flush();
+   cred_valid = 0;
+   for(row=0;row<CRED_ROWS;++row)
+   {
+      read_program_memory(CRED_BASE+(int16)bank*CRED_BANK+(int16)row*CRED_ROW,
+                          cred_row, CRED_ROW*2);
+      for(i=0;i<CRED_ROW*2;++i)
+         crc = cred_crc(crc, cred_row[i]);
+   }
+   return(crc);
+}
+
+int16 cred_ee16(BYTE a)
+{
+   return(make16(read_eeprom(a), read_eeprom(a+1)));
+}
+
+int1 cred_bank_ok(BYTE bank)
+{
+   return(cred_bank_crc(bank) == cred_ee16(CRED_EE_HDR+bank*4+2));
+}
+
+void cred_use(BYTE bank)
+{
+   cred_flush();
+   cred_at = CRED_BASE + (int16)bank*CRED_BANK;
+   cred_valid = 0;
+}
+
+void cred_init(void)
+{
+   BYTE b;
+
+   b = read_eeprom(CRED_EE_BANK);
+   if(b > 1)                        // lost mid-write: newest generation
+      b = cred_ee16(CRED_EE_HDR+4) > cred_ee16(CRED_EE_HDR) &&
+          cred_ee16(CRED_EE_HDR+4) != 0xFFFF;
+   if(!cred_bank_ok(b) && cred_bank_ok(b^1))
+      b ^= 1;
+   cred_live = b;                   // neither valid: new device, use b
+   cred_use(b);
+}
+
+// Make the idle bank a copy of the live one, rewriting only rows that
+// differ, and leave it selected for writing.
+void cred_level(void)
+{
+   BYTE row, i;
+   int16 to;
+
+   to = CRED_BASE + (int16)(cred_live^1)*CRED_BANK;
+   cred_use(cred_live);
+   for(row=0;row<CRED_ROWS;++row)
+   {
+      cred_load(row);
+      for(i=0;i<CRED_ROW;++i)
+         if(read_program_eeprom(to+(int16)row*CRED_ROW+i) !=
+            make16(cred_row[2*i+1], cred_row[2*i]))
+            break;
+      if(i < CRED_ROW)
+         write_program_memory(to+(int16)row*CRED_ROW, cred_row, CRED_ROW*2);
+   }
+   cred_use(cred_live^1);
+}
+
+int1 cred_sync(void)
+{
+   BYTE k, s, i, idle, a;
+   int16 gen, crc;
+   int1 ok = TRUE;
+
+   if(!cred_staged)
+      return(TRUE);
+   OV_CHECK(OV_STAGE);
+   cred_level();
+   for(k=0;k<cred_staged;++k)       // @wcet CRED_STAGE
+   {
+      if(cred_search(cred_stage[k].uid))
+      {
+         s = cred_slot;
+         if(cred_stage[k].user == CRED_DELETE)
+            CRED_STATE(s) = CRED_DEAD;
+         else
+            CRED_USER(s) = cred_stage[k].user & 0x3F;
+         cred_dirty = 1;
+      }
+      else if(cred_stage[k].user != CRED_DELETE)
+      {
+         if(!cred_has_free)
+         {
+            ok = FALSE;
+            break;
+         }
+         cred_load(cred_free_row);
+         s = cred_free_slot;
+         for(i=0;i<8;++i)
+            cred_row[(s<<3)+i] = 0x3F;
+         for(i=0;i<4;++i)
+            CRED_UID(s,i) = cred_stage[k].uid[i];
+         CRED_USER(s) = cred_stage[k].user & 0x3F;
+         CRED_STATE(s) = CRED_LIVE;
+         cred_dirty = 1;
+      }
+   }
+   cred_flush();
+   cred_staged = 0;
+   if(!ok)                          // stay on the live bank, all or nothing
+   {
+      cred_use(cred_live);
+      return(FALSE);
+   }
+
+   idle = cred_live^1;
+   crc = cred_bank_crc(idle);
+   gen = cred_ee16(CRED_EE_HDR+cred_live*4) + 1;
+   a = CRED_EE_HDR+idle*4;
+   write_eeprom(a, make8(gen,1));
+   write_eeprom(a+1, make8(gen,0));
+   write_eeprom(a+2, make8(crc,1));
+   write_eeprom(a+3, make8(crc,0));
+   write_eeprom(CRED_EE_BANK, idle);         // the switch
+   cred_live = idle;
+   cred_use(idle);
+   return(TRUE);
+}
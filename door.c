@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////
+////                              DOOR.C                               ////
+////             Strike outputs for several doors on PORTC             ////
+////                                                                   ////
+////  door_init()         Drive every strike pin low.                  ////
+////                                                                   ////
+////  door_mask(user)     Doors a user number may open, bit n for      ////
+////                      door n.  Read from data EEPROM; an erased    ////
+////                      byte gives DOOR_DEFAULT, the main door       ////
+////                      only, so a door added later stays shut to    ////
+////                      users no one has given it.  Bits for doors   ////
+////                      not fitted are dropped.                      ////
+////                                                                   ////
+////  door_grant(mask)    Unlock the doors in mask.  A door with a     ////
+////                      hold time stays unlocked that many ms and    ////
+////                      relocks on its own; a door with hold time 0  ////
+////                      toggles on every grant.  All strikes change  ////
+////                      in one port write.  Returns the doors in     ////
+////                      mask now unlocked; door_shut holds the       ////
+////                      toggling doors it locked again.              ////
+////                                                                   ////
+////  door_set(mask)      door_grant() for callers already running     ////
+////                      with the tick masked, or from the tick.      ////
+////                                                                   ////
+////  door_isr()          Call from the 1 ms tick.  Relocks expired    ////
+////                      doors, again in one port write.              ////
+////                                                                   ////
+////  Each door has its own relock timer.  Add a door by extending     ////
+////  DOOR_BIT and DOOR_HOLD and raising DOORS.                        ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef DOORS
+   #define DOORS        2
+#endif
+#ifndef DOOR_HOLDS
+   #define DOOR_HOLDS   {0, 5000}   // ms unlocked per door, 0 = toggle
+#endif
+#ifndef DOOR_EE_MASK
+   #define DOOR_EE_MASK 0x40        // one door mask per user number
+   #define DOOR_USERS   64
+#endif
+#ifndef DOOR_DEFAULT
+   #define DOOR_DEFAULT 0x01        // erased mask, built-in users
+#endif
+#define DOOR_ALL        ((1 << DOORS) - 1)
+
+#ifdef __PCM__
+#byte DOOR_PORT = getenv("SFR:PORTC")
+#byte DOOR_TRIS = getenv("SFR:TRISC")
+#else
+#define DOOR_PORT PORTC
+#define DOOR_TRIS TRISC
+#endif
+
+const BYTE DOOR_BIT[DOORS]   = {0x02, 0x10};   // C1 main door, C4 inner door
+const int16 DOOR_HOLD[DOORS] = DOOR_HOLDS;
+
+BYTE door_out = 0;                  // strike pins now driven high
+BYTE door_shut = 0;                 // toggling doors the last grant locked
+int16 door_timer[DOORS];            // ms until relock, 0 = no timer
+
+void door_init(void)
+{
+   BYTE d, pins = 0;
+
+   for(d=0;d<DOORS;++d)
+   {
+      pins |= DOOR_BIT[d];
+      door_timer[d] = 0;
+   }
+   DOOR_PORT &= ~pins;
+   DOOR_TRIS &= ~pins;
+   door_out = 0;
+}
+
+BYTE door_mask(BYTE user)
+{
+   BYTE mask;
+
+   if(user >= DOOR_USERS)
+      return(DOOR_DEFAULT);         // past the table: as if erased
+   mask = read_eeprom(DOOR_EE_MASK+user);
+   if(mask == 0xFF)
+      return(DOOR_DEFAULT);
+   return(mask & DOOR_ALL);
+}
+
+#ifdef __PCM__
+#inline
+#endif
+BYTE door_set(BYTE mask)
+{
+   BYTE d, bit, on = 0, off = 0, open = 0;
+
+   door_shut = 0;
+   for(d=0, bit=1; d<DOORS; ++d, bit<<=1)
+   {
+      if(!(mask & bit))
+         continue;
+      if(DOOR_HOLD[d] == 0 && (door_out & DOOR_BIT[d]))
+      {
+         off |= DOOR_BIT[d];
+         door_shut |= bit;
+         continue;
+      }
+      on |= DOOR_BIT[d];
+      door_timer[d] = DOOR_HOLD[d];
+      open |= bit;
+   }
+   DOOR_PORT = (DOOR_PORT | on) & ~off;
+   door_out = (door_out | on) & ~off;
+   return(open);
+}
+
+BYTE door_grant(BYTE mask)
+{
+   BYTE open;
+
+   disable_interrupts(INT_TIMER2);
+   open = door_set(mask);
+   enable_interrupts(INT_TIMER2);
+   return(open);
+}
+
+#ifdef __PCM__
+#inline
+#endif
+void door_isr(void)
+{
+   BYTE d, off = 0;
+
+   for(d=0;d<DOORS;++d)
+      if(door_timer[d] && !--door_timer[d])
+         off |= DOOR_BIT[d];
+   if(off)
+   {
+      DOOR_PORT &= ~off;
+      door_out &= ~off;
+   }
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////
+////                           INTERLOCK.C                             ////
+////            Two-door airlock on top of the door table              ////
+////                                                                   ////
+////  Door 0 is the outer door and door 1 the inner door.  A door is   ////
+////  only unlocked while the other one is locked and its contact      ////
+////  has read shut for IL_SETTLE_MS, so the two are never open at     ////
+////  the same time.                                                   ////
+////                                                                   ////
+////  il_init()         Enable the door contact pull-ups.  Call after  ////
+////                    wgi_init(), which sets WPUB outright.          ////
+////                                                                   ////
+////  il_request(mask)  Queue a request for the doors in mask.  Each   ////
+////                    door keeps up to IL_QUEUE requests and opens   ////
+////                    once for each, in turn.  A request is dropped  ////
+////                    when it has been first in line for IL_WAIT_MS  ////
+////                    without its door being able to open.  Asking   ////
+////                    for both doors runs one airlock cycle.         ////
+////                    Returns FALSE, queuing nothing, when a door    ////
+////                    in mask already has IL_QUEUE waiting.          ////
+////                                                                   ////
+////  il_isr()          Call from the 1 ms tick after door_isr().      ////
+////                    Every decision is made here, so a request      ////
+////                    is answered within 1 ms of the door becoming   ////
+////                    free.  The door whose first request waited     ////
+////                    longest goes first; on a tie the outer door.   ////
+////                                                                   ////
+////  il_served         Doors opened through the interlock.            ////
+////                                                                   ////
+////  Door contacts close to ground when the door is shut.  The doors  ////
+////  need a hold time in DOOR_HOLDS; a toggling door would never      ////
+////  release the other one.                                           ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef IL_SENSE_0
+   #define IL_SENSE_0     1         // PORTB bit, outer door contact
+   #define IL_SENSE_1     2         // PORTB bit, inner door contact
+#endif
+#ifndef IL_SETTLE_MS
+   #define IL_SETTLE_MS   200       // contact must read shut this long
+#endif
+#ifndef IL_WAIT_MS
+   #define IL_WAIT_MS     30000     // a request its door never served
+#endif
+#ifndef IL_QUEUE
+   #define IL_QUEUE       8         // requests waiting per door
+#endif
+
+#ifdef __PCM__
+#byte IL_PORT = getenv("SFR:PORTB")
+#byte IL_WPUB = getenv("SFR:WPUB")
+#else
+#define IL_PORT PORTB
+#define IL_WPUB WPUB
+#endif
+
+BYTE il_want[2] = {0, 0};           // requests waiting for each door
+int16 il_age[2];                    // ms the first of them has waited
+int16 il_shut[2];                   // ms each contact has read shut
+int16 il_served = 0;
+
+void il_init(void)
+{
+   port_b_pullups(IL_WPUB | (1 << IL_SENSE_0) | (1 << IL_SENSE_1));
+   il_shut[0] = il_shut[1] = 0;
+}
+
+int1 il_request(BYTE mask)
+{
+   int1 ok = FALSE;
+
+   disable_interrupts(INT_TIMER2);
+   if(!((mask & 1) && il_want[0] >= IL_QUEUE) &&
+      !((mask & 2) && il_want[1] >= IL_QUEUE))
+   {
+      if((mask & 1) && !il_want[0]++)
+         il_age[0] = 0;
+      if((mask & 2) && !il_want[1]++)
+         il_age[1] = 0;
+      ok = TRUE;
+   }
+   enable_interrupts(INT_TIMER2);
+   return(ok);
+}
+
+#ifdef __PCM__
+#inline
+#endif
+void il_isr(void)
+{
+   BYTE d;
+
+   if(bit_test(IL_PORT, IL_SENSE_0))
+      il_shut[0] = 0;
+   else if(il_shut[0] < IL_SETTLE_MS)
+      ++il_shut[0];
+   if(bit_test(IL_PORT, IL_SENSE_1))
+      il_shut[1] = 0;
+   else if(il_shut[1] < IL_SETTLE_MS)
+      ++il_shut[1];
+
+   // the next in line starts its own wait
+   if(il_want[0] && ++il_age[0] >= IL_WAIT_MS)
+   {
+      --il_want[0];
+      il_age[0] = 0;
+   }
+   if(il_want[1] && ++il_age[1] >= IL_WAIT_MS)
+   {
+      --il_want[1];
+      il_age[1] = 0;
+   }
+
+   if(il_want[0] && il_want[1])
+      d = (il_age[1] > il_age[0]);
+   else if(il_want[0])
+      d = 0;
+   else if(il_want[1])
+      d = 1;
+   else
+      return;
+
+   // the other door locked and settled shut, this one locked
+   if(door_out & (DOOR_BIT[d ^ 1] | DOOR_BIT[d]))
+      return;
+   if(il_shut[d ^ 1] < IL_SETTLE_MS)
+      return;
+   door_set(1 << d);
+   --il_want[d];
+   il_age[d] = 0;
+   ++il_served;
+}
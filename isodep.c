@@ -0,0 +1,274 @@
+///////////////////////////////////////////////////////////////////////////
+////                            ISODEP.C                               ////
+////         ISO14443-4 (ISO-DEP) transport for phones and DESFire     ////
+////                                                                   ////
+////  isodep_open(buf)   Send RATS, read the ATS and, when the card    ////
+////                     offers it, switch both directions to the      ////
+////                     fastest common bit rate with PPS.  While FSD  ////
+////                     is over the 64 byte FIFO the card sends at    ////
+////                     212 kbit/s at most, the fastest rate          ////
+////                     rc522_finish() drains a long frame at.  buf   ////
+////                     is scratch space of ISODEP_ATS_MAX bytes.     ////
+////                     The card must be selected.  Returns TRUE      ////
+////                     when the session is open.                     ////
+////                                                                   ////
+////  isodep_apdu(capdu,clen,rapdu,rmax)                               ////
+////                     Send one command APDU and return the length   ////
+////                     of the response, or ISODEP_FAIL.  Long        ////
+////                     commands and responses are chained in         ////
+////                     I-blocks of the largest size both sides       ////
+////                     accept.  The response starts at rapdu[1];     ////
+////                     rapdu[0] and two bytes past the end are       ////
+////                     scratch, so rmax = response + 3.  capdu and   ////
+////                     rapdu may only share memory when the command  ////
+////                     fits one frame.                               ////
+////                                                                   ////
+////  isodep_close()     Send S(DESELECT) and restore the reader to    ////
+////                     106 kbit/s and the library timer settings.    ////
+////                                                                   ////
+////  There is no door credential over ISO-DEP: any phone can emulate  ////
+////  a card and answer a SELECT, so a grant needs a challenge-        ////
+////  response first (see CARD_ROUTES in card.c).                      ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef ISODEP_FSDI
+   #define ISODEP_FSDI     7        // FSD 128: largest frame rc522_finish takes
+#endif
+#ifndef ISODEP_MAXBR
+   #define ISODEP_MAXBR    3        // 0=106 1=212 2=424 3=848 kbit/s
+#endif
+// Each FIFO read costs about 50 us over SPI: at 424 kbit/s a byte comes
+// every 21 us and a frame over 64 bytes overflows (test/t_rc522io.c)
+#if ISODEP_FSDI > 5 && ISODEP_MAXBR > 1
+   #define ISODEP_MAXDS    1        // card to reader rate
+#else
+   #define ISODEP_MAXDS    ISODEP_MAXBR
+#endif
+#ifndef ISODEP_WTX_MAX
+   #define ISODEP_WTX_MAX  8        // waiting time extensions granted per block
+#endif
+#define ISODEP_ATS_MAX     32
+#define ISODEP_FAIL        0xFF
+
+#define RC_TXMODEREG       0x12
+#define RC_RXMODEREG       0x13
+#define RC_MODWIDTHREG     0x24
+#define RC_TMODEREG        0x2A
+#define RC_TPRESCALERREG   0x2B
+#define RC_TRELOADREGH     0x2C
+#define RC_TRELOADREGL     0x2D
+
+// I-block frame sizes for FSCI 0..8, and modulation width per bit rate
+BYTE const ISO_FSC[9] = {16, 24, 32, 40, 48, 64, 96, 128, 255};
+BYTE const ISO_MODWIDTH[4] = {0x26, 0x15, 0x0A, 0x05};
+
+// session state, in the overlay arena while OV_ISO is held
+typedef struct
+{
+   BYTE fsc;                        // INF bytes per frame we may send
+   BYTE bn;                         // block number
+   int16 fwt;                       // frame waiting time, reader timer ticks
+} ISO_STATE;
+
+#define ISO_FWT_MAX        8193     // FWI 14, the cap on FWT * WTXM too
+
+#define iso    ((ISO_STATE *)&ov_arena[OV_ISO_AT])
+
+BYTE iso_rate(BYTE bits, BYTE max) // bits: 1=212 2=424 4=848
+{
+   if((bits & 4) && max >= 3)
+      return(3);
+   if((bits & 2) && max >= 2)
+      return(2);
+   if((bits & 1) && max >= 1)
+      return(1);
+   return(0);
+}
+
+void iso_reload(int16 ticks)
+{
+   MFRC522_Wr(RC_TRELOADREGH, make8(ticks,1));
+   MFRC522_Wr(RC_TRELOADREGL, make8(ticks,0));
+}
+
+// frame waiting time 302us * 2^fwi on a 604us reader timer tick
+void iso_timeout(BYTE fwi)
+{
+   iso->fwt = ((int16)1 << fwi) / 2 + 1;
+   MFRC522_Wr(RC_TMODEREG, 0x8F);              // TAuto, prescaler 0xFFF
+   MFRC522_Wr(RC_TPRESCALERREG, 0xFF);
+   iso_reload(iso->fwt);
+}
+
+void iso_speed(BYTE dsi, BYTE dri)
+{
+   MFRC522_Wr(RC_TXMODEREG, dri << 4);
+   MFRC522_Wr(RC_RXMODEREG, dsi << 4);
+   MFRC522_Wr(RC_MODWIDTHREG, ISO_MODWIDTH[dri]);
+}
+
+// Back to 106 kbit/s and the MFRC522_Init() timer, and end the session
+void iso_reset(void)
+{
+   iso_speed(0, 0);
+   MFRC522_Wr(RC_TMODEREG, 0x8D);
+   MFRC522_Wr(RC_TPRESCALERREG, 0x3E);
+   iso_reload(30);
+   OV_GIVE(OV_ISO);
+}
+
+int1 isodep_open(char *buf)
+{
+   BYTE n, i, t0, ta, fsci, fwi, dsi, dri;
+
+   buf[0] = 0xE0;                               // RATS, CID 0
+   buf[1] = ISODEP_FSDI << 4;
+   rc522_start(buf, 2, 1);
+   n = rc522_finish(buf, ISODEP_ATS_MAX, 1);
+   if(n == RC_FAIL || n == 0 || buf[0] != n)
+      return(FALSE);
+
+   t0 = (n > 1) ? buf[1] : 0x02;                // default FSCI 2
+   fsci = t0 & 0x0F;
+   if(fsci > 8)
+      fsci = 8;
+   i = 2;
+   ta = 0;
+   fwi = 4;
+   if(bit_test(t0,4))
+      ta = buf[i++];
+   if(bit_test(t0,5))
+      fwi = buf[i++] >> 4;
+   if(fwi > 14)
+      fwi = 4;
+
+   // we stream the answer but load a whole frame into the 64 byte FIFO
+   OV_TAKE(OV_ISO);
+   iso->fsc = ISO_FSC[fsci];
+   if(iso->fsc > 64)
+      iso->fsc = 64;
+   iso->fsc -= 3;                               // PCB and CRC
+   iso->bn = 0;
+   iso_timeout(fwi);
+
+   dsi = iso_rate(ta >> 4, ISODEP_MAXDS);
+   dri = iso_rate(ta, ISODEP_MAXBR);
+   if(bit_test(ta,7))                           // same rate both ways
+   {
+      if(dsi > dri)
+         dsi = dri;
+      dri = dsi;
+   }
+   if(dsi || dri)
+   {
+      buf[0] = 0xD0;                            // PPSS, CID 0
+      buf[1] = 0x11;                            // PPS1 follows
+      buf[2] = (dsi << 2) | dri;
+      rc522_start(buf, 3, 1);
+      if(rc522_finish(buf, 3, 1) != 1 || buf[0] != 0xD0)
+      {
+         iso_reset();
+         return(FALSE);
+      }
+      iso_speed(dsi, dri);
+   }
+   return(TRUE);
+}
+
+// Receive one block at rx, answering up to ISODEP_WTX_MAX S(WTX)
+// requests.  Each answer gives the card FWT * WTXM for its next frame
+// only.  Returns the frame length including the PCB, or RC_FAIL.
+BYTE iso_recv(char *rx, BYTE max)
+{
+   BYTE n, k;
+   int1 longer = FALSE;
+   int32 t;
+   char wtx[2];
+
+   for(k=0;k<=ISODEP_WTX_MAX;++k)
+   {
+      n = rc522_finish(rx, max, 1);
+      if(longer)
+         iso_reload(iso->fwt);
+      if(n == RC_FAIL || n == 0)
+         return(RC_FAIL);
+      if((rx[0] & 0xF7) != 0xF2)                // not S(WTX)
+         return(n);
+      wtx[0] = 0xF2;
+      wtx[1] = rx[1] & 0x3F;
+      t = (int32)iso->fwt * (wtx[1] ? wtx[1] : 1);
+      if(t > ISO_FWT_MAX)
+         t = ISO_FWT_MAX;
+      iso_reload(t);
+      longer = TRUE;
+      rc522_start(wtx, 2, 1);
+   }
+   return(RC_FAIL);
+}
+
+BYTE isodep_apdu(char *capdu, BYTE clen, char *rapdu, BYTE rmax)
+{
+   BYTE pos, n, m, got;
+   char pcb, keep;
+   int1 more;
+
+   // command: chained I-blocks, each acknowledged by R(ACK)
+   pos = 0;
+   do
+   {
+      n = clen - pos;
+      more = n > iso->fsc;
+      if(more)
+         n = iso->fsc;
+      pcb = 0x02 | iso->bn;
+      if(more)
+         pcb |= 0x10;
+      rc522_open();
+      rc522_put(&pcb, 1);
+      rc522_put(capdu+pos, n);
+      rc522_go(1);
+      pos += n;
+      m = iso_recv(rapdu, rmax);
+      if(m == RC_FAIL)
+         return(ISODEP_FAIL);
+      if(more && (rapdu[0] & 0xF7) != (0xA2 | iso->bn))    // R(ACK) of it
+         return(ISODEP_FAIL);
+      iso->bn ^= 1;
+   } while(more);                               // @wcet 16: FSC >= 16
+
+   // response: each chained frame lands on the last data byte received so
+   // far; its PCB overwrites that byte, which is put back afterwards.  An
+   // I-block carries the number of the block it answers.
+   got = 0;
+   pcb = rapdu[0];
+   for(;;)                                      // @wcet ISODEP_ATS_MAX+1
+   {
+      n = m - 1;
+      if((pcb & 0xE3) != (0x02 | (iso->bn ^ 1)))
+         return(ISODEP_FAIL);
+      if(!bit_test(pcb,4))
+         return(got + n);
+      if(!n)                                    // chained blocks carry data
+         return(ISODEP_FAIL);
+      got += n;
+      keep = rapdu[got];
+      pcb = 0xA2 | iso->bn;
+      rc522_start(&pcb, 1, 1);
+      m = iso_recv(rapdu+got, rmax-got);
+      if(m == RC_FAIL)
+         return(ISODEP_FAIL);
+      iso->bn ^= 1;
+      pcb = rapdu[got];
+      rapdu[got] = keep;
+   }
+}
+
+void isodep_close(void)
+{
+   char buf[3];
+
+   buf[0] = 0xC2;                               // S(DESELECT)
+   rc522_start(buf, 1, 1);
+   rc522_finish(buf, 3, 1);
+   iso_reset();
+}
@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////
+////                           ISR_STAT.C                              ////
+////          Interrupt latency and handler time measurement           ////
+////                                                                   ////
+////  Define ISR_STATS to build the counters in; otherwise the macros  ////
+////  below expand to nothing.  Timer1 runs free at 5 MHz as the time  ////
+////  base, so all figures are in 0.2 us units.                        ////
+////                                                                   ////
+////  isr_stat_init()       Start Timer1.                              ////
+////  ISR_ENTER()           First statement of a handler.              ////
+////  ISR_LEAVE(src)        Last statement: records the run time.      ////
+////  ISR_WAIT(src,t)       Record t as the delay from the interrupt   ////
+////                        flag to the handler (timer sources can     ////
+////                        read it from their own count).             ////
+////                                                                   ////
+////  isr_count[src]        Handler runs.                              ////
+////  isr_time[src]         Longest handler run.                       ////
+////  isr_wait[src]         Longest flag to handler delay.             ////
+////                                                                   ////
+////  The service order of the handlers is fixed by #priority in the   ////
+////  application.                                                     ////
+///////////////////////////////////////////////////////////////////////////
+
+#define ISR_TIMER2      0
+#define ISR_RTCC        1
+#define ISR_RB          2
+#define ISR_EXT         3
+#define ISR_SOURCES     4
+
+#ifdef ISR_STATS
+
+int16 isr_count[ISR_SOURCES];
+int16 isr_time[ISR_SOURCES];
+int16 isr_wait[ISR_SOURCES];
+int16 isr_t0, isr_dt;
+
+#define ISR_ENTER()     isr_t0 = get_timer1()
+#define ISR_LEAVE(s)    { isr_dt = get_timer1() - isr_t0;           \
+                          ++isr_count[s];                            \
+                          if(isr_dt > isr_time[s]) isr_time[s] = isr_dt; }
+#define ISR_WAIT(s,t)   { isr_dt = (t);                              \
+                          if(isr_dt > isr_wait[s]) isr_wait[s] = isr_dt; }
+
+void isr_stat_init(void)
+{
+   setup_timer_1(T1_INTERNAL|T1_DIV_BY_1);
+}
+
+#else
+
+#define ISR_ENTER()
+#define ISR_LEAVE(s)
+#define ISR_WAIT(s,t)
+#define isr_stat_init()
+
+#endif
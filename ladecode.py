@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Timing report from a logic analyzer capture of the door controller.
+
+Reads a sigrok-cli or PulseView CSV export and measures, per tap:
+
+    tap-decide   marker 1 (card seen) to marker 2 (decision made)
+    tap-relay    marker 1 to the next strike relay change
+    tap-beep     marker 1 to the first buzzer pulse
+    lcd-update   one burst of LCD enable pulses, first to last edge
+    beep         width of one buzzer pulse
+
+Build the firmware with MARK_PIN defined to get the markers: a tap is one
+short pulse on that pin, a decision two.  Default channels and the pins
+to probe:
+
+    mark   PIN_D1   MARK_PIN
+    cs     PIN_D3   MFRC522_CS   (edges counted only)
+    en     PIN_D5   LCD_ENABLE_PIN
+    buz    PIN_C0   buzzer
+    relay  PIN_C1   strike relay
+
+Sample at 5 MHz or more so the 1 us marker pulses are seen.
+
+usage: ladecode.py capture.csv [--ch name=column ...] [--rate Hz]
+
+A column is given by its header name or by its number, 0 being the first
+column after the time column (if any).  Defaults: mark=D1 cs=D3 en=D5
+buz=C0 relay=C1, matching channels named after the pins.
+"""
+
+import argparse
+import re
+import sys
+
+DEFAULT = {'mark': 'D1', 'cs': 'D3', 'en': 'D5', 'buz': 'C0', 'relay': 'C1'}
+MARK_GAP = 20e-6        # marker pulses closer than this form one marker
+LCD_GAP = 2e-3          # enable pulses closer than this form one update
+TAP_WINDOW = 5.0        # longest tap to relay/beep time looked for
+
+
+def rate_of(text):
+    m = re.search(r'([\d.]+)\s*([kMG]?)Hz', text)
+    if not m:
+        return None
+    return float(m.group(1)) * {'': 1, 'k': 1e3, 'M': 1e6, 'G': 1e9}[m.group(2)]
+
+
+def load(path, rate):
+    """Return (names, edges) with edges[name] = [(time, level), ...]."""
+    names, rows, timed = None, [], False
+    for line in open(path):
+        line = line.strip()
+        if not line:
+            continue
+        if line.startswith(';'):
+            if 'amplerate' in line and rate is None:
+                rate = rate_of(line)
+            continue
+        f = [x.strip() for x in line.split(',')]
+        if names is None and not re.match(r'^[-\d.eE+]+$', f[0]):
+            timed = f[0].lower().startswith('time')
+            names = f[1:] if timed else f
+            continue
+        rows.append(f)
+    if not rows:
+        sys.exit('%s: no samples' % path)
+    if names is None:
+        names = ['%d' % i for i in range(len(rows[0]))]
+    if not timed and rate is None:
+        sys.exit('%s: no time column or samplerate; give --rate' % path)
+
+    edges = {n: [] for n in names}
+    last = [None] * len(names)
+    for i, f in enumerate(rows):
+        t = float(f[0]) if timed else i / rate
+        vals = f[1:] if timed else f
+        for k, v in enumerate(vals[:len(names)]):
+            v = int(v)
+            if v != last[k]:
+                if last[k] is not None:
+                    edges[names[k]].append((t, v))
+                last[k] = v
+    return names, edges
+
+
+def pick(names, edges, spec):
+    """Map our channel names to capture columns."""
+    out = {}
+    for ours, col in spec.items():
+        if col in edges:
+            out[ours] = edges[col]
+        elif col.isdigit() and int(col) < len(names):
+            out[ours] = edges[names[int(col)]]
+        else:
+            out[ours] = None
+    return out
+
+
+def pulses(e):
+    """(start, end) of every high pulse."""
+    out, start = [], None
+    for t, v in e:
+        if v:
+            start = t
+        elif start is not None:
+            out.append((start, t))
+            start = None
+    return out
+
+
+def groups(p, gap):
+    """Merge pulses closer than gap: (start, end, count)."""
+    out = []
+    for s, e in p:
+        if out and s - out[-1][1] < gap:
+            out[-1] = (out[-1][0], e, out[-1][2] + 1)
+        else:
+            out.append((s, e, 1))
+    return out
+
+
+def first_after(times, t):
+    for x in times:
+        if t < x <= t + TAP_WINDOW:
+            return x
+    return None
+
+
+def measure(ch):
+    res = {k: [] for k in ('tap-decide', 'tap-relay', 'tap-beep',
+                           'lcd-update', 'beep')}
+    taps, decides = [], []
+    if ch['mark']:
+        for s, e, n in groups(pulses(ch['mark']), MARK_GAP):
+            (taps if n == 1 else decides).append(s)
+    relay = [t for t, v in ch['relay']] if ch['relay'] else []
+    beeps = pulses(ch['buz']) if ch['buz'] else []
+
+    for i, t in enumerate(taps):
+        nxt = taps[i + 1] if i + 1 < len(taps) else float('inf')
+        for name, times in (('tap-decide', decides), ('tap-relay', relay),
+                            ('tap-beep', [s for s, e in beeps])):
+            x = first_after(times, t)
+            if x is not None and x < nxt:
+                res[name].append(x - t)
+    if ch['en']:
+        res['lcd-update'] = [e - s for s, e, n in
+                             groups(pulses(ch['en']), LCD_GAP)]
+    res['beep'] = [e - s for s, e in beeps]
+    return res
+
+
+def pct(v, p):
+    v = sorted(v)
+    return v[min(len(v) - 1, max(0, int(round(p / 100.0 * len(v))) - 1))]
+
+
+def main():
+    ap = argparse.ArgumentParser(description='door controller timings')
+    ap.add_argument('capture')
+    ap.add_argument('--ch', action='append', default=[],
+                    metavar='NAME=COLUMN')
+    ap.add_argument('--rate', type=float, help='samplerate, Hz')
+    a = ap.parse_args()
+
+    spec = dict(DEFAULT)
+    for c in a.ch:
+        name, _, col = c.partition('=')
+        if name not in spec:
+            sys.exit('unknown channel %s (%s)' % (name, ', '.join(spec)))
+        spec[name] = col
+    names, edges = load(a.capture, a.rate)
+    ch = pick(names, edges, spec)
+    for name, col in spec.items():
+        if ch[name] is None:
+            print('note: no column %s for %s' % (col, name))
+    if ch['cs']:
+        print('reader: %d chip selects' % (len(ch['cs']) // 2))
+
+    print('%-11s %5s %9s %9s %9s %9s' % ('ms', 'n', 'p50', 'p90', 'p99',
+                                         'max'))
+    for name, v in measure(ch).items():
+        if not v:
+            print('%-11s %5d' % (name, 0))
+            continue
+        print('%-11s %5d %9.3f %9.3f %9.3f %9.3f'
+              % (name, len(v), pct(v, 50) * 1e3, pct(v, 90) * 1e3,
+                 pct(v, 99) * 1e3, max(v) * 1e3))
+
+
+if __name__ == '__main__':
+    main()
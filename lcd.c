@@ -3,6 +3,7 @@
 ////                 Driver for common LCD modules                         ////
 ////                                                                       ////
 ////  lcd_init()   Must be called before any other function.               ////
+////               Returns FALSE if the display does not answer.           ////
 ////                                                                       ////
 ////  lcd_putc(c)  Will display c on the next position of the LCD.         ////
 ////                     The following have special meaning:               ////
@@ -14,6 +15,10 @@
 ////                                                                       ////
 ////  lcd_getc(x,y)   Returns character at position x,y on LCD             ////
 ////                                                                       ////
+////  lcd_scrub()  With LCD_SCRUB defined, keeps a RAM copy of the         ////
+////               screen and checks the display against it, one bus       ////
+////               transfer per call.  Call it once per tick.              ////
+////                                                                       ////
 ////  CONFIGURATION                                                        ////
 ////  The LCD can be configured in one of two ways: a.) port access or     ////
 ////  b.) pin access.  Port access requires the entire 7 bit interface     ////
@@ -89,27 +94,40 @@ typedef struct
 
 ////////////////////// END CONFIGURATION ///////////////////////////////////
 
+// Bus trace hook.  #define LCD_TRACE(line,x) before including this file to
+// see every RS, RW and enable change and every data nibble written or
+// read, in bus order.  A host build can record these to check that a
+// modified driver still produces the same HD44780 transactions.
+#ifndef LCD_TRACE
+   #define LCD_TRACE(line,x)
+#endif
+#define LCD_TR_ENABLE   0
+#define LCD_TR_RS       1
+#define LCD_TR_RW       2
+#define LCD_TR_WRITE    3     // data nibble driven by the PIC
+#define LCD_TR_READ     4     // data nibble driven by the LCD
+
 #ifndef LCD_ENABLE_PIN
-   #define lcd_output_enable(x) lcdlat.enable=x
+   #define lcd_output_enable(x) do{lcdlat.enable=x; LCD_TRACE(LCD_TR_ENABLE,x);}while(0)
    #define lcd_enable_tris()   lcdtris.enable=0
 #else
-   #define lcd_output_enable(x) output_bit(LCD_ENABLE_PIN, x)
+   #define lcd_output_enable(x) do{output_bit(LCD_ENABLE_PIN, x); LCD_TRACE(LCD_TR_ENABLE,x);}while(0)
    #define lcd_enable_tris()  output_drive(LCD_ENABLE_PIN)
 #endif
 
 #ifndef LCD_RS_PIN
-   #define lcd_output_rs(x) lcdlat.rs=x
+   #define lcd_output_rs(x) do{lcdlat.rs=x; LCD_TRACE(LCD_TR_RS,x);}while(0)
    #define lcd_rs_tris()   lcdtris.rs=0
 #else
-   #define lcd_output_rs(x) output_bit(LCD_RS_PIN, x)
+   #define lcd_output_rs(x) do{output_bit(LCD_RS_PIN, x); LCD_TRACE(LCD_TR_RS,x);}while(0)
    #define lcd_rs_tris()  output_drive(LCD_RS_PIN)
 #endif
 
 #ifndef LCD_RW_PIN
-   #define lcd_output_rw(x) lcdlat.rw=x
+   #define lcd_output_rw(x) do{lcdlat.rw=x; LCD_TRACE(LCD_TR_RW,x);}while(0)
    #define lcd_rw_tris()   lcdtris.rw=0
 #else
-   #define lcd_output_rw(x) output_bit(LCD_RW_PIN, x)
+   #define lcd_output_rw(x) do{output_bit(LCD_RW_PIN, x); LCD_TRACE(LCD_TR_RW,x);}while(0)
    #define lcd_rw_tris()  output_drive(LCD_RW_PIN)
 #endif
 
@@ -195,12 +213,14 @@ BYTE lcd_read_byte(void)
    lcd_output_enable(1);
    delay_cycles(1);
    high = lcd_read_nibble();
+   LCD_TRACE(LCD_TR_READ,high);
       
    lcd_output_enable(0);
    delay_cycles(1);
    lcd_output_enable(1);
    delay_us(1);
    low = lcd_read_nibble();
+   LCD_TRACE(LCD_TR_READ,low);
       
    lcd_output_enable(0);
 
@@ -237,6 +257,36 @@ BYTE lcd_read_nibble(void)
   #endif
 }
 
+#ifndef LCD_BUSY_TIMEOUT
+   #define LCD_BUSY_TIMEOUT 1000   // busy flag polls before giving up (~10ms)
+#endif
+
+int1 lcd_fault = 0;                 // set when the controller stops answering
+#ifdef LCD_SCRUB
+int1 lcd_idle = 0;                  // lcd_scrub() read the busy flag clear
+#endif
+
+// Poll the busy flag with a bounded number of reads.  Returns TRUE when the
+// controller is ready.  After a timeout lcd_fault is set and later calls
+// return at once; lcd_send_byte() then waits out each instruction with the
+// datasheet times, so a display whose busy flag cannot be read still works.
+int1 lcd_wait_ready(void)
+{
+   int16 n;
+
+   if(lcd_fault)
+      return(FALSE);
+
+   lcd_output_rs(0);
+   for(n=0;n<LCD_BUSY_TIMEOUT;++n)
+   {
+      if(!bit_test(lcd_read_byte(),7))
+         return(TRUE);
+   }
+   lcd_fault = 1;
+   return(FALSE);
+}
+
 void lcd_send_nibble(BYTE n)
 {
   #if (defined(LCD_DATA4) && defined(LCD_DATA5) && defined(LCD_DATA6) && defined(LCD_DATA7))
@@ -248,6 +298,7 @@ void lcd_send_nibble(BYTE n)
   #else      
    lcdlat.data = n;
   #endif
+   LCD_TRACE(LCD_TR_WRITE,n);
       
    delay_cycles(1);
    lcd_output_enable(1);
@@ -255,10 +306,9 @@ void lcd_send_nibble(BYTE n)
    lcd_output_enable(0);
 }
 
-void lcd_send_byte(BYTE address, BYTE n)
+// The transfer alone, for a caller that has just read the busy flag clear
+void lcd_put_byte(BYTE address, BYTE n)
 {
-   lcd_output_rs(0);
-   while ( bit_test(lcd_read_byte(),7) ) ;
    lcd_output_rs(address);
    delay_cycles(1);
    lcd_output_rw(0);
@@ -268,7 +318,83 @@ void lcd_send_byte(BYTE address, BYTE n)
    lcd_send_nibble(n & 0xf);
 }
 
-void lcd_init(void) 
+void lcd_send_byte(BYTE address, BYTE n)
+{
+   int1 ready;
+
+   ready = lcd_wait_ready();
+   lcd_put_byte(address, n);
+#ifdef LCD_SCRUB
+   lcd_idle = 0;                    // busy again
+#endif
+   if(!ready)
+   {
+      if(!address && n < 4)
+         delay_ms(2);                // clear or home, 1.52ms
+      else
+         delay_us(50);               // 37us
+   }
+}
+
+#ifdef LCD_SCRUB
+#ifndef LCD_COLS
+   #define LCD_COLS     16
+#endif
+#define LCD_CELLS       (LCD_COLS*2)
+#ifndef LCD_SCRUB_BAD
+   #define LCD_SCRUB_BAD 3          // wrong readbacks in a row before a reset
+#endif
+#ifndef LCD_RETRY
+   #define LCD_RETRY    256         // calls before a dead display is retried
+   #define LCD_RETRY_MAX 7          // doublings of that wait, 32768 calls
+#endif
+#define LCD_AC_LOST     0xFF        // lcd_ac after a write: set it first
+
+char lcd_shadow[LCD_CELLS];         // what the screen should show
+BYTE lcd_addr = 0;                  // DDRAM address the application is at
+BYTE lcd_ac = 0;                    // the controller's address counter
+BYTE lcd_cell = 0;                  // next cell to check
+BYTE lcd_bad = 0;                   // wrong readbacks in a row
+BYTE lcd_tries = 0;                 // failed retries of a dead display
+int16 lcd_retry = LCD_RETRY;        // calls left before the next retry
+int1 lcd_known = 0;                 // lcd_shadow follows the screen
+int1 lcd_fix = 0;                   // lcd_cell read wrong, rewrite it
+int1 lcd_away = 0;                  // the scrubber moved the counter
+
+// Screen cell at DDRAM address a, or 0xFF when a is off screen
+BYTE lcd_cell_of(BYTE a)
+{
+   if(a < LCD_COLS)
+      return(a);
+   if(a >= LCD_LINE_TWO && a < LCD_LINE_TWO+LCD_COLS)
+      return(a - LCD_LINE_TWO + LCD_COLS);
+   return(0xFF);
+}
+
+// Address counter after a read or write at a (two-line mode)
+BYTE lcd_after(BYTE a)
+{
+   if(a == 0x27)
+      return(0x40);
+   if(a == 0x67)
+      return(0x00);
+   return(a + 1);
+}
+
+// The application set the address to a.  Outside the DDRAM the controller
+// is not predictable, so the copy is not trusted again until a clear.
+void lcd_moved(BYTE a)
+{
+   lcd_addr = lcd_ac = a;
+   lcd_away = 0;
+   if(a >= 0x68 || (a >= 0x28 && a < 0x40))
+      lcd_known = 0;
+}
+#endif
+
+// Returns TRUE when the display answered.  The power-on steps use the
+// datasheet minimums; the busy flag is polled once 4-bit mode is set.
+int1 lcd_init(void) 
 {
    BYTE i;
 
@@ -291,17 +417,28 @@ void lcd_init(void)
    lcd_output_rs(0);
    lcd_output_rw(0);
    lcd_output_enable(0);
+   lcd_fault = 0;
     
-   delay_ms(15);
-   for(i=1;i<=3;++i)
-   {
-       lcd_send_nibble(3);
-       delay_ms(5);
-   }
+   delay_ms(15);                 // >15ms after Vcc rises to 4.5V
+   lcd_send_nibble(3);
+   delay_us(4100);               // >4.1ms
+   lcd_send_nibble(3);
+   delay_us(100);                // >100us
+   lcd_send_nibble(3);
+   delay_us(40);                 // 37us execution, busy flag not valid yet
     
    lcd_send_nibble(2);
    for(i=0;i<=3;++i)
       lcd_send_byte(0,LCD_INIT_STRING[i]);
+
+   // a missing display reads back a floating or stuck bus, so check that
+   // the address counter follows a set DDRAM address command
+   lcd_send_byte(0,0x80|LCD_LINE_TWO);
+   if(!lcd_wait_ready() || (lcd_read_byte() & 0x7F) != LCD_LINE_TWO)
+      lcd_fault = 1;
+   lcd_send_byte(0,0x80);
+
+   return(!lcd_fault);
 }
 
 void lcd_gotoxy(BYTE x, BYTE y)
@@ -315,21 +452,52 @@ void lcd_gotoxy(BYTE x, BYTE y)
      
    address+=x-1;
    lcd_send_byte(0,0x80|address);
+#ifdef LCD_SCRUB
+   lcd_moved(address);
+#endif
 }
 
 void lcd_putc(char c)
 {
+#ifdef LCD_SCRUB
+   BYTE i;
+
+   // the scrubber may have left the address counter elsewhere
+   if(c != '\f' && c != '\n' && lcd_away)
+      lcd_send_byte(0,0x80|lcd_addr);
+#endif
    switch (c)
    {
       case '\f'   :  lcd_send_byte(0,1);
                      delay_ms(2);
+#ifdef LCD_SCRUB
+                     for(i=0;i<LCD_CELLS;++i)
+                        lcd_shadow[i] = ' ';
+                     lcd_moved(0);
+                     lcd_known = 1;
+#endif
                      break;
                      
       case '\n'   : lcd_gotoxy(1,2);        break;
      
-      case '\b'   : lcd_send_byte(0,0x10);  break;
+      case '\b'   : lcd_send_byte(0,0x10);
+#ifdef LCD_SCRUB
+                     if(lcd_addr == 0x40)
+                        lcd_moved(0x27);
+                     else
+                        lcd_moved((lcd_addr - 1) & 0x7F);
+#endif
+                     break;
      
-      default     : lcd_send_byte(1,c);     break;
+      default     : lcd_send_byte(1,c);
+#ifdef LCD_SCRUB
+                     i = lcd_cell_of(lcd_addr);
+                     if(i != 0xFF)
+                        lcd_shadow[i] = c;
+                     lcd_moved(lcd_after(lcd_addr));
+                     lcd_ac = LCD_AC_LOST;
+#endif
+                     break;
    }
 }
  
@@ -338,10 +506,116 @@ char lcd_getc(BYTE x, BYTE y)
    char value;
 
    lcd_gotoxy(x,y);
-   while ( bit_test(lcd_read_byte(),7) ); // wait until busy flag is low
+   lcd_wait_ready();                      // wait until busy flag is low
    lcd_output_rs(1);
    value = lcd_read_byte();
    lcd_output_rs(0);
+#ifdef LCD_SCRUB
+   lcd_ac = lcd_after(lcd_ac);
+   lcd_away = 1;
+#endif
    
    return(value);
 }
+
+#ifdef LCD_SCRUB
+// Initialise the controller again and put the copy back on the screen
+void lcd_redraw(void)
+{
+   BYTE i;
+
+   lcd_bad = 0;
+   lcd_fix = 0;
+   if(!lcd_init())
+      return;
+   for(i=0;i<LCD_CELLS;++i)
+   {
+      if(i == LCD_COLS)
+         lcd_send_byte(0,0x80|LCD_LINE_TWO);
+      lcd_send_byte(1,lcd_shadow[i]);
+   }
+   lcd_send_byte(0,0x80|lcd_addr);
+   lcd_ac = lcd_addr;
+   lcd_away = 0;
+}
+
+// One step of the background check, one bus transfer per call: a status
+// read, then on the next call one more transfer: move the address counter,
+// read a cell, or rewrite a cell that read wrong.  That transfer needs no
+// busy poll of its own, since nothing has been sent since the status read
+// (lcd_send_byte() clears lcd_idle).  Cells are read in order, so the
+// counter mostly moves by itself.  A counter that is not where it should be, or LCD_SCRUB_BAD
+// wrong cells running, means the controller lost its state (ESD resets it
+// to 8-bit mode): it is initialised again and the screen redrawn.  After a
+// write the counter is not checked until the next move sets it.  A display
+// that stopped answering is retried after LCD_RETRY calls, and the wait
+// doubles after each retry that fails, since each costs lcd_init()'s 20ms.
+void lcd_scrub(void)
+{
+   BYTE a, c;
+
+   if(!lcd_known)
+      return;
+   if(lcd_fault)
+   {
+      if(--lcd_retry)
+         return;
+      lcd_redraw();
+      if(lcd_fault && lcd_tries < LCD_RETRY_MAX)
+         ++lcd_tries;
+      else if(!lcd_fault)
+         lcd_tries = 0;
+      lcd_retry = (int16)LCD_RETRY << lcd_tries;
+      return;
+   }
+
+   if(!lcd_idle)
+   {
+      lcd_output_rs(0);
+      c = lcd_read_byte();
+      if(bit_test(c,7))                   // busy: try on the next call
+         return;
+      if(lcd_ac != LCD_AC_LOST && c != lcd_ac)
+         lcd_redraw();
+      else
+         lcd_idle = 1;
+      return;
+   }
+   lcd_idle = 0;
+
+   a = lcd_cell;
+   if(a >= LCD_COLS)
+      a += LCD_LINE_TWO - LCD_COLS;
+   if(lcd_ac != a)
+   {
+      lcd_put_byte(0,0x80|a);
+      lcd_ac = a;
+      lcd_away = 1;
+      return;
+   }
+   lcd_away = 1;
+   if(lcd_fix)
+   {
+      lcd_put_byte(1,lcd_shadow[lcd_cell]);
+      lcd_fix = 0;
+      lcd_ac = LCD_AC_LOST;
+      if(++lcd_cell >= LCD_CELLS)
+         lcd_cell = 0;
+      return;
+   }
+   lcd_output_rs(1);
+   c = lcd_read_byte();
+   lcd_output_rs(0);
+   lcd_ac = lcd_after(a);
+   if(c != lcd_shadow[lcd_cell])
+   {
+      lcd_fix = 1;
+      if(++lcd_bad >= LCD_SCRUB_BAD)
+         lcd_redraw();
+      return;
+   }
+   lcd_bad = 0;
+   if(++lcd_cell >= LCD_CELLS)
+      lcd_cell = 0;
+}
+#endif
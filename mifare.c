@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////
+////                            MIFARE.C                               ////
+////            MIFARE Classic sector credential reader                ////
+////                                                                   ////
+////  mf_init()           Load the site key and site code from data    ////
+////                      EEPROM.  Call once after MFRC522_Init().     ////
+////                      While either is erased (the factory key      ////
+////                      FFFFFFFFFFFF, site FFFF) no card is granted. ////
+////                                                                   ////
+////  mf_read_blocks(uid,first,count,out)                              ////
+////                      Read count data blocks starting at first,    ////
+////                      skipping sector trailers.  Each sector is    ////
+////                      authenticated once (MFAuthent) and every     ////
+////                      block in it is read under that session.      ////
+////                      out needs 16*count+2 bytes.  The card must   ////
+////                      be selected.                                 ////
+////                                                                   ////
+////  mf_cred(uid,&user)  Check the credential blocks of a selected    ////
+////                      card.  TRUE if they carry our site code,     ////
+////                      are bound to this uid, and the uid is in     ////
+////                      the cred.c store with the same user.  An     ////
+////                      admin card (user MF_ADMIN) is passed on      ////
+////                      without the store check; prov.c checks its   ////
+////                      MAC instead.                                 ////
+////                                                                   ////
+////  mf_end()            Drop the Crypto1 session.  Call after        ////
+////                      MFRC522_Halt().                              ////
+////                                                                   ////
+////  Credential layout (sector MF_CRED_BLOCK/4, key A):               ////
+////     block MF_CRED_BLOCK    bytes 0-1 site code, byte 2 user       ////
+////     block MF_CRED_BLOCK+1  bytes 0-3 copy of the card uid         ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef MF_CRED_BLOCK
+   #define MF_CRED_BLOCK   4
+#endif
+#ifndef MF_EE_KEY
+   #define MF_EE_KEY       0x00     // 6 byte key A, erased = FFFFFFFFFFFF
+   #define MF_EE_SITE      0x06     // 2 byte site code
+#endif
+
+#define MF_STATUS2REG      0x08
+#define MF_CRYPTO1ON       0x08
+#define MF_ADMIN           0xFF     // user number of an admin card (prov.c)
+#define MF_READ_MAX        2        // most blocks a caller reads at once
+
+char mf_key[6];                     // site key, kept in RAM between taps
+char mf_site[2];
+BYTE mf_sector = 0xFF;              // sector of the open Crypto1 session
+int1 mf_set = 0;                    // key and site code programmed
+
+void mf_init(void)
+{
+   BYTE i, k = 0xFF;
+
+   for(i=0;i<6;++i)
+   {
+      mf_key[i] = read_eeprom(MF_EE_KEY+i);
+      k &= mf_key[i];
+   }
+   mf_site[0] = read_eeprom(MF_EE_SITE);
+   mf_site[1] = read_eeprom(MF_EE_SITE+1);
+   mf_set = k != 0xFF && (mf_site[0] & mf_site[1]) != 0xFF;
+}
+
+void mf_end(void)
+{
+   MFRC522_Wr(MF_STATUS2REG, MFRC522_Rd(MF_STATUS2REG) & ~MF_CRYPTO1ON);
+   mf_sector = 0xFF;
+}
+
+int1 mf_read_blocks(char uid[], BYTE first, BYTE count, char *out)
+{
+   BYTE blk;
+
+   for(blk=first; count; ++blk)     // @wcet MF_READ_MAX+1: and a trailer
+   {
+      if((blk & 3) == 3)               // sector trailer
+         continue;
+      if((blk >> 2) != mf_sector)
+      {
+         if(MFRC522_Auth(PICC_AUTHENT1A, blk, mf_key, uid) != MI_OK)
+         {
+            mf_sector = 0xFF;
+            return(FALSE);
+         }
+         mf_sector = blk >> 2;
+      }
+      if(MFRC522_Read(blk, out) != MI_OK)
+         return(FALSE);
+      out += 16;
+      --count;
+   }
+   return(TRUE);
+}
+
+int1 mf_cred(char uid[], BYTE *user)
+{
+   char blk[MF_READ_MAX*16+2];
+   BYTE u;
+
+   if(!mf_read_blocks(uid, MF_CRED_BLOCK, 2, blk))
+      return(FALSE);
+   if(blk[0] != mf_site[0] || blk[1] != mf_site[1])
+      return(FALSE);
+   if(blk[16] != uid[0] || blk[17] != uid[1] ||
+      blk[18] != uid[2] || blk[19] != uid[3])
+      return(FALSE);
+   *user = blk[2];
+   if(*user == MF_ADMIN)
+      return(TRUE);
+   // anyone can write a card with the factory key: the key must be ours,
+   // and the badge must be enrolled as the user the card names
+   return(mf_set && cred_find(uid, &u) && u == *user);
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////
+////                             MSG.C                                 ////
+////              Compressed LCD message catalog decoder               ////
+////                                                                   ////
+////  msg_puts(id)  Writes message id (MSG_xxx from msg_table.h)       ////
+////                straight to lcd_putc, one character at a time.     ////
+////                                                                   ////
+////  The tables are generated from messages.txt by msggen.py; see     ////
+////  that script for the token format.  Rerun it after editing the    ////
+////  message list.                                                    ////
+///////////////////////////////////////////////////////////////////////////
+
+#include <msg_table.h>
+
+#define MSG_CAP      0x40     // first letter upper case
+#define MSG_UPPER    0x80     // whole word upper case
+#define MSG_END      0xC0
+#define MSG_FF       0xC1
+#define MSG_NL       0xC2
+
+void msg_puts(BYTE id)
+{
+   BYTE t, w, c, mode;
+   int1 gap = 0;
+
+   for(;;)                    // @wcet 34: a token prints at least one letter
+   {
+      t = MSG_TOKENS[id++];
+      if(t >= MSG_END)
+      {
+         gap = 0;
+         if(t == MSG_END)
+            return;
+         if(t == MSG_FF)
+            lcd_putc('\f');
+         else if(t == MSG_NL)
+            lcd_putc('\n');
+         else
+            for(t -= MSG_NL; t; --t)      // @wcet 16
+               lcd_putc(' ');
+         continue;
+      }
+
+      // skip to the start of word (t & 0x3F): one pass over the words
+      // before it, however many there are
+      w = 0;
+      for(c = t & 0x3F; c; )     // @wcet MSG_WORDS_LEN
+         if(bit_test(MSG_WORDS[w++],7))
+            --c;
+
+      if(gap)
+         lcd_putc(' ');
+      mode = t & 0xC0;
+      do
+      {
+         c = MSG_WORDS[w++];
+         t = c & 0x7F;
+         if(mode && t >= 'a' && t <= 'z')
+            t -= 'a' - 'A';
+         lcd_putc(t);
+         if(mode == MSG_CAP)
+            mode = 0;
+      } while(!bit_test(c,7));   // @wcet 16
+      gap = 1;
+   }
+}
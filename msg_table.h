@@ -0,0 +1,36 @@
+// Generated by msggen.py from messages.txt -- do not edit.
+#define MSG_TITLE      0
+#define MSG_GROUP      5
+#define MSG_INIT       8
+#define MSG_DONE       12
+#define MSG_SCAN       15
+#define MSG_TRUNG      21
+#define MSG_HUY        27
+#define MSG_MEMBER     33
+#define MSG_WELCOME    38
+#define MSG_CLOSED     43
+#define MSG_INVALID    48
+#define MSG_WARNING    53
+#define MSG_PROV       55
+#define MSG_WORDS_LEN  119
+
+BYTE const MSG_WORDS[119] = {
+   0x68,0xE5,0x74,0x68,0x6F,0x6E,0xE7,0x6D,0xEF,0x63,0x75,0xE1,
+   0x6E,0x68,0x6F,0xED,0x31,0xB0,0x69,0x6E,0x69,0x74,0x69,0x61,
+   0x6C,0x69,0x7A,0x69,0x6E,0xE7,0x2A,0x2A,0x2A,0x2A,0x2A,0x44,
+   0x6F,0x6E,0x65,0x21,0x2A,0x2A,0x2A,0x2A,0x2A,0xAA,0x78,0x69,
+   0xEE,0x6D,0x6F,0xE9,0x71,0x75,0x65,0xF4,0x74,0x68,0xE5,0x74,
+   0x68,0x61,0x6E,0xE8,0x74,0x72,0x75,0x6E,0xE7,0x68,0x75,0xF9,
+   0x76,0x69,0x65,0xEE,0x62,0x61,0xEE,0x76,0x61,0xEF,0x64,0xE1,
+   0x64,0x75,0x6F,0xE3,0x64,0x6F,0x6E,0xE7,0x6B,0x68,0x6F,0x6E,
+   0xE7,0x68,0x6F,0xF0,0x6C,0xE5,0x77,0x61,0x72,0x6E,0x69,0x6E,
+   0x67,0x21,0x21,0xA1,0x63,0x61,0xF0,0x6E,0x68,0x61,0xF4
+};
+BYTE const MSG_TOKENS[61] = {
+   0x80,0x81,0x82,0x83,0xC0,0x84,0x05,0xC0,0xC1,0xC4,0x46,0xC0,
+   0xC2,0x07,0xC0,0xC1,0x48,0x09,0x0A,0x0B,0xC0,0xC1,0xC3,0x4C,
+   0x4D,0xC3,0xC0,0xC1,0xC6,0x4C,0x4E,0xC6,0xC0,0xC1,0xC5,0x4C,
+   0x0F,0xC0,0x08,0x09,0x10,0x11,0xC0,0x43,0x12,0x13,0x14,0xC0,
+   0x4B,0x15,0x16,0x17,0xC0,0x98,0xC0,0xC1,0xC4,0x52,0x19,0x1A,
+   0xC0
+};
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Build the LCD message catalog.
+
+Reads messages.txt and writes msg_table.h for msg.c.  Each word is stored
+once; a message is a list of one-byte tokens:
+
+    00-3F  word n as stored
+    40-7F  word n with the first letter in upper case
+    80-BF  word n in upper case
+    C0     end of message
+    C1     clear display (\\f)
+    C2     second line (\\n)
+    C3-FF  (token - C2) spaces, 1 to 61
+
+A single space between two words is implied.  Words are packed back to back
+in MSG_WORDS with bit 7 set on the last letter, so word n is found by
+counting n terminators and no offset table is needed.
+
+usage: msggen.py [messages.txt] [msg_table.h]
+"""
+
+import re
+import sys
+
+WORD, CAP, UPPER = 0x00, 0x40, 0x80
+END, FF, NL, SP = 0xC0, 0xC1, 0xC2, 0xC2
+
+
+def load(path):
+    msgs = []
+    for n, line in enumerate(open(path), 1):
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        m = re.match(r'(\w+)\s+"(.*)"$', line)
+        if not m:
+            sys.exit('%s:%d: expected  ID "text"' % (path, n))
+        text = m.group(2).replace('\\f', '\f').replace('\\n', '\n')
+        msgs.append((m.group(1), text))
+    return msgs
+
+
+def split_word(w):
+    """Return (stored form, case mode) for one word."""
+    low = w.lower()
+    if w == low:
+        return w, WORD
+    if w == w.upper() and len(w) > 1:
+        return low, UPPER
+    if w[0].isupper() and w[1:] == low[1:]:
+        return low, CAP
+    return w, WORD
+
+
+def encode(msgs):
+    words, index, tokens, offsets = [], {}, [], []
+    for name, text in msgs:
+        offsets.append((name, len(tokens)))
+        for part in re.findall(r'\f|\n| +|[^ \f\n]+', text):
+            if part == '\f':
+                tokens.append(FF)
+            elif part == '\n':
+                tokens.append(NL)
+            elif part[0] == ' ':
+                if len(part) > 0xFF - SP:
+                    sys.exit('%s: run of %d spaces (max %d)'
+                             % (name, len(part), 0xFF - SP))
+                tokens.append(None if len(part) == 1 else SP + len(part))
+            else:
+                if not all(' ' < c < '\x7f' for c in part):
+                    sys.exit('%s: %r is not printable ASCII (bit 7 ends '
+                             'a word)' % (name, part))
+                stored, mode = split_word(part)
+                if stored not in index:
+                    index[stored] = len(words)
+                    words.append(stored)
+                tokens.append(mode | index[stored])
+        # a lone space between two words is implied by the decoder
+        out = tokens[:offsets[-1][1]]
+        body = tokens[offsets[-1][1]:]
+        for i, t in enumerate(body):
+            if t is None:
+                if 0 < i < len(body) - 1 and body[i - 1] < END \
+                        and body[i + 1] is not None and body[i + 1] < END:
+                    continue
+                t = SP + 1
+            out.append(t)
+        out.append(END)
+        tokens = out
+
+    blob = []
+    for w in words:
+        blob += [ord(c) for c in w]
+        blob[-1] |= 0x80
+
+    if len(words) > 64:
+        sys.exit('too many words (%d, max 64: the token holds a 6-bit '
+                 'index)' % len(words))
+    # ids 0xFD-0xFF are left free for callers' own codes (code1.c's
+    # THE_CAP, THE_LOI and THE_SAI)
+    if len(blob) > 256 or len(tokens) > 0xFD:
+        sys.exit('catalog does not fit byte offsets')
+    return words, blob, tokens, offsets
+
+
+def table(name, data):
+    rows = []
+    for i in range(0, len(data), 12):
+        rows.append('   ' + ','.join('0x%02X' % b for b in data[i:i + 12]))
+    return 'BYTE const %s[%d] = {\n%s\n};\n' % (name, len(data),
+                                                ',\n'.join(rows))
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else 'messages.txt'
+    dst = sys.argv[2] if len(sys.argv) > 2 else 'msg_table.h'
+    msgs = load(src)
+    words, blob, tokens, offsets = encode(msgs)
+
+    out = ['// Generated by msggen.py from %s -- do not edit.\n' % src]
+    for name, ofs in offsets:
+        out.append('#define %-14s %d\n' % (name, ofs))
+    out.append('#define %-14s %d\n' % ('MSG_WORDS_LEN', len(blob)))
+    out.append('\n')
+    out.append(table('MSG_WORDS', blob))
+    out.append(table('MSG_TOKENS', tokens))
+    open(dst, 'w', newline='\r\n').write(''.join(out))
+
+    # table bytes only: msg_puts() itself is not counted, so this is not
+    # the ROM saved; compare the compiler's ROM figure for that
+    plain = sum(len(t) + 1 for _, t in msgs)
+    packed = len(blob) + len(tokens)
+    print('%d messages, %d words: %d bytes as literals, %d bytes of tables'
+          % (len(msgs), len(words), plain, packed))
+
+
+if __name__ == '__main__':
+    main()
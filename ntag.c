@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////
+////                             NTAG.C                                ////
+////            NTAG21x / Ultralight credential reader                 ////
+////                                                                   ////
+////  ntag_fast_read(first,last,out)                                   ////
+////                      Read pages first..last with one FAST_READ    ////
+////                      (0x3A) frame.  The answer is streamed out    ////
+////                      of the FIFO as it arrives, so ranges over    ////
+////                      16 pages (64 bytes) need no second request.  ////
+////                      out needs 4*(last-first+1)+2 bytes and at    ////
+////                      most 63 pages can be read at once.           ////
+////                                                                   ////
+////  ntag_cred(uid,&user)                                             ////
+////                      Check the credential pages of a selected     ////
+////                      tag.  TRUE if they carry our site code and   ////
+////                      are bound to this 7 byte uid.  The pages     ////
+////                      are not authenticated, so the check proves   ////
+////                      nothing: card.c keeps CARD_NTAG out of       ////
+////                      CARD_ROUTES.                                 ////
+////                                                                   ////
+////  Credential layout, from page NTAG_CRED_PAGE:                     ////
+////     bytes 0-1 site code, byte 2 user, byte 3 unused,              ////
+////     bytes 4-10 copy of the tag uid                                ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef NTAG_CRED_PAGE
+   #define NTAG_CRED_PAGE  4
+   #define NTAG_CRED_PAGES 3
+#endif
+
+#define NTAG_FAST_READ     0x3A
+
+int1 ntag_fast_read(BYTE first, BYTE last, char *out)
+{
+   BYTE n;
+
+   n = (last-first+1) << 2;
+   out[0] = NTAG_FAST_READ;
+   out[1] = first;
+   out[2] = last;
+   rc522_start(out, 3, 1);
+   return(rc522_finish(out, n+2, 1) == n);
+}
+
+int1 ntag_cred(char uid[], BYTE *user)
+{
+   char buf[NTAG_CRED_PAGES*4+2];
+   BYTE i;
+
+   if(!ntag_fast_read(NTAG_CRED_PAGE, NTAG_CRED_PAGE+NTAG_CRED_PAGES-1, buf))
+      return(FALSE);
+   if(buf[0] != mf_site[0] || buf[1] != mf_site[1])
+      return(FALSE);
+   for(i=0;i<7;++i)
+      if(buf[4+i] != uid[i])
+         return(FALSE);
+   *user = buf[2];
+   return(TRUE);
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////
+////                            OVERLAY.C                              ////
+////          Shared RAM for state that lives in one mode only         ////
+////                                                                   ////
+////  The compiler already overlays function locals whose call trees   ////
+////  never meet.  ov_arena covers the state that has to outlive a     ////
+////  call but belongs to one mode of the controller; the modes never  ////
+////  run together, so their state shares the same bytes:              ////
+////                                                                   ////
+////     OV_STAGE   cred.c change stage, claimed by the caller before  ////
+////                the first cred_stage_add() and released after      ////
+////                cred_sync()                                        ////
+////     OV_PROV    provisioning: the stage plus prov.c's MAC and      ////
+////                EEPROM stage                                       ////
+////     OV_ISO     ISO-DEP session, isodep_open() to isodep_close()   ////
+////                                                                   ////
+////  OV_TAKE(o)    Claim the arena for mode o.                        ////
+////  OV_GIVE(o)    Release it.                                        ////
+////  OV_CHECK(o)   Assert that the holder has every part of mode o,   ////
+////                so OV_CHECK(OV_STAGE) also passes under OV_PROV.   ////
+////                                                                   ////
+////  With OV_DEBUG defined the macros track the owner, and the first  ////
+////  clash is kept in ov_fault as (holder << 4) | claimant; without   ////
+////  it they expand to nothing.                                       ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef CRED_STAGE
+   #define CRED_STAGE      4        // changes held in RAM before a sync
+#endif
+#ifndef PROV_EE_PAIRS
+   #define PROV_EE_PAIRS   8        // changed EEPROM bytes per admin card
+#endif
+
+#define OV_FREE            0        // modes are bit sets of what they hold
+#define OV_STAGE           1
+#define OV_PROV            3        // stage + prov.c state
+#define OV_ISO             4
+
+// arena map
+#define OV_STAGE_AT        0                    // CRED_OP, 5 bytes each
+#define OV_PROV_AT         (CRED_STAGE*5)       // beside the stage it fills
+#define OV_ISO_AT          0                    // 4 bytes
+#ifdef PROV_CARD
+   #define OV_SIZE         (OV_PROV_AT + 27 + PROV_EE_PAIRS*2)
+#else
+   #define OV_SIZE         OV_PROV_AT
+#endif
+
+BYTE ov_arena[OV_SIZE];
+
+#ifdef OV_DEBUG
+
+BYTE ov_owner = OV_FREE;
+BYTE ov_fault = 0;
+
+#define OV_CLASH(o)     { if(!ov_fault) ov_fault = (ov_owner << 4) | (o); }
+#define OV_TAKE(o)      { if(ov_owner != OV_FREE) OV_CLASH(o);  ov_owner = (o); }
+#define OV_GIVE(o)      { if(ov_owner != (o)) OV_CLASH(o);  ov_owner = OV_FREE; }
+#define OV_CHECK(o)     { if((ov_owner & (o)) != (o)) OV_CLASH(o); }
+
+#else
+
+#define OV_TAKE(o)
+#define OV_GIVE(o)
+#define OV_CHECK(o)
+
+#endif
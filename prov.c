@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////
+////                              PROV.C                               ////
+////          Signed MIFARE Classic cards that reconfigure a door      ////
+////                                                                   ////
+////  prov_card(uid)    Apply the provisioning card in the field.      ////
+////                    Called once mf_cred() has returned PROV_USER.  ////
+////                    TRUE when every change was written.            ////
+////                                                                   ////
+////  The card holds a normal credential (site code, user PROV_USER)   ////
+////  and, from block PROV_BLOCK on, one 16 byte record per data       ////
+////  block, sector trailers skipped:                                  ////
+////                                                                   ////
+////     header   'P' 'V' seq(2) site(2) n                             ////
+////     n records                                                     ////
+////        01 uid(4) user          add or update a badge              ////
+////        02 uid(4)               remove a badge                     ////
+////        03 addr len data(len)   write data EEPROM, len <= 13,      ////
+////                                within PROV_EE_LO..PROV_EE_HI      ////
+////     MAC      XTEA CBC-MAC of the header and records, 8 bytes      ////
+////                                                                   ////
+////  Every block is read once, under one authentication per sector.   ////
+////  Badge changes go to the cred.c stage and EEPROM bytes that       ////
+////  differ from the chip to prov->ee.  Nothing is written unless the ////
+////  MAC matches and seq is above the last applied one; then the      ////
+////  badges go out in one cred_sync(), the staged EEPROM bytes        ////
+////  follow and seq is stored last.  A card with more changes than    ////
+////  the stages hold is refused, as is a user number the store can't  ////
+////  hold (CRED_USERS and up), an EEPROM record outside the door      ////
+////  masks and seq 0xFFFF, which reads back as erased.  The keys,     ////
+////  site code, seq and cred.c bank headers are never written by a    ////
+////  card.                                                            ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef PROV_BLOCK
+   #define PROV_BLOCK      8        // first block of sector 2
+   #define PROV_RECORDS    7        // records that fit in sectors 2-4
+#endif
+#ifndef PROV_EE_KEY
+   #define PROV_EE_KEY     0x08     // 16 byte XTEA key
+   #define PROV_EE_SEQ     0x18     // 2 byte last applied seq
+#endif
+#ifndef PROV_EE_LO
+   #define PROV_EE_LO      0x40     // EE records: DOOR_EE_MASK and up
+   #define PROV_EE_HI      0xFF
+#endif
+#define PROV_USER          MF_ADMIN // user number of an admin card
+
+#define PROV_ADD           0x01
+#define PROV_DEL           0x02
+#define PROV_EE            0x03
+
+// state while a card is read, in the overlay arena beside the cred.c
+// stage (OV_PROV); sized there from PROV_EE_PAIRS
+typedef struct
+{
+   int32 mac[2];
+   int32 key[4];                    // XTEA key, read once per card
+   int16 seq;
+   BYTE n;
+   BYTE ee[PROV_EE_PAIRS][2];       // staged EEPROM writes: addr, value
+} PROV_STATE;
+
+#define prov   ((PROV_STATE *)&ov_arena[OV_PROV_AT])
+
+// block k of the provisioning area, counted without trailers
+BYTE prov_block(BYTE k)
+{
+   return(PROV_BLOCK + k + k/3);
+}
+
+// Load the XTEA key into prov->key; FALSE while it is erased
+int1 prov_load_key(void)
+{
+   BYTE i, a;
+   int1 set = FALSE;
+
+   for(i=0;i<4;++i)
+   {
+      a = PROV_EE_KEY + (i << 2);
+      prov->key[i] = make32(read_eeprom(a), read_eeprom(a+1),
+                            read_eeprom(a+2), read_eeprom(a+3));
+      if(prov->key[i] != 0xFFFFFFFF)
+         set = TRUE;
+   }
+   return(set);
+}
+
+// XTEA, 32 cycles, on prov->mac
+void prov_xtea(void)
+{
+   int32 v0, v1, sum = 0;
+   BYTE i;
+
+   v0 = prov->mac[0];
+   v1 = prov->mac[1];
+   for(i=0;i<32;++i)
+   {
+      v0 += (((v1 << 4) ^ (v1 >> 5)) + v1)
+            ^ (sum + prov->key[make8(sum,0) & 3]);
+      sum += 0x9E3779B9;
+      v1 += (((v0 << 4) ^ (v0 >> 5)) + v0)
+            ^ (sum + prov->key[(make8(sum,1) >> 3) & 3]);
+   }
+   prov->mac[0] = v0;
+   prov->mac[1] = v1;
+}
+
+// CBC step over one 16 byte block
+void prov_chain(char b[])
+{
+   BYTE h;
+
+   for(h=0;h<16;h+=8)
+   {
+      prov->mac[0] ^= make32(b[h], b[h+1], b[h+2], b[h+3]);
+      prov->mac[1] ^= make32(b[h+4], b[h+5], b[h+6], b[h+7]);
+      prov_xtea();
+   }
+}
+
+// Stage the bytes of an EEPROM record that differ from the chip
+int1 prov_stage_ee(char b[])
+{
+   BYTE i;
+
+   if(b[2] > 13 || b[1] < PROV_EE_LO ||
+      (int16)b[1] + b[2] > (int16)PROV_EE_HI + 1)
+      return(FALSE);
+   for(i=0;i<b[2];++i)              // @wcet 13
+   {
+      if(read_eeprom(b[1]+i) == b[3+i])
+         continue;
+      if(prov->n >= PROV_EE_PAIRS)
+         return(FALSE);
+      prov->ee[prov->n][0] = b[1]+i;
+      prov->ee[prov->n][1] = b[3+i];
+      ++prov->n;
+   }
+   return(TRUE);
+}
+
+int1 prov_check(char uid[])
+{
+   char b[18];
+   BYTE n, k, i;
+
+   if(!prov_load_key())             // no key set: refuse every card
+      return(FALSE);
+   prov->mac[0] = prov->mac[1] = 0;
+   if(!mf_read_blocks(uid, prov_block(0), 1, b))
+      return(FALSE);
+   n = b[6];
+   prov->seq = make16(b[2], b[3]);
+   if(b[0] != 'P' || b[1] != 'V' || n > PROV_RECORDS ||
+      b[4] != mf_site[0] || b[5] != mf_site[1] || prov->seq == 0xFFFF)
+      return(FALSE);
+   prov_chain(b);
+   for(k=1;k<=n;++k)                // @wcet PROV_RECORDS
+   {
+      if(!mf_read_blocks(uid, prov_block(k), 1, b))
+         return(FALSE);
+      prov_chain(b);
+      if(b[0] == PROV_ADD &&
+         (b[5] >= CRED_USERS || !cred_stage_add(&b[1], b[5])))
+         return(FALSE);
+      if(b[0] == PROV_DEL && !cred_stage_del(&b[1]))
+         return(FALSE);
+      if(b[0] == PROV_EE && !prov_stage_ee(b))
+         return(FALSE);
+   }
+   if(!mf_read_blocks(uid, prov_block(k), 1, b))
+      return(FALSE);
+   for(i=0;i<8;++i)
+      if(b[i] != make8(prov->mac[i >> 2], 3 - (i & 3)))
+         return(FALSE);
+   i = read_eeprom(PROV_EE_SEQ);
+   k = read_eeprom(PROV_EE_SEQ+1);
+   if((i & k) == 0xFF)              // erased: no card applied yet
+      return(TRUE);
+   return(prov->seq > make16(i, k));
+}
+
+int1 prov_card(char uid[])
+{
+   BYTE i;
+
+   int1 ok = FALSE;
+
+   OV_TAKE(OV_PROV);
+   cred_staged = 0;
+   prov->n = 0;
+   if(!prov_check(uid))
+      cred_staged = 0;
+   else if(cred_sync())
+   {
+      for(i=0;i<prov->n;++i)        // @wcet PROV_EE_PAIRS
+         write_eeprom(prov->ee[i][0], prov->ee[i][1]);
+      write_eeprom(PROV_EE_SEQ, make8(prov->seq,1));
+      write_eeprom(PROV_EE_SEQ+1, make8(prov->seq,0));
+      ok = TRUE;
+   }
+   OV_GIVE(OV_PROV);
+   return(ok);
+}
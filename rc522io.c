@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////
+////                            RC522IO.C                              ////
+////          Streaming MFRC522 transceive and cascade select          ////
+////                                                                   ////
+////  rc522_start(tx,len,crc)   Load len bytes (plus CRC_A when crc    ////
+////                            is set) into the FIFO and start a      ////
+////                            Transceive.  len+2 must fit the FIFO.  ////
+////                                                                   ////
+////  rc522_open()  rc522_put(tx,len)  rc522_go(crc)                   ////
+////                            The same in steps, for frames built    ////
+////                            from more than one buffer.             ////
+////                                                                   ////
+////  rc522_finish(rx,max,crc)  Collect the answer.  The FIFO is       ////
+////                            drained while the frame is still       ////
+////                            arriving, so answers longer than the   ////
+////                            64 byte FIFO are received whole.       ////
+////                            Returns the data length (CRC checked   ////
+////                            and stripped when crc is set) or       ////
+////                            RC_FAIL.  rx needs max bytes, which    ////
+////                            must include the two CRC bytes.        ////
+////                                                                   ////
+////  rc522_select(uid,&len)    Anticollision and select for cascade   ////
+////                            levels 1 and 2.  uid receives 4 or 7   ////
+////                            bytes.  Returns SAK or RC_FAIL.        ////
+////                                                                   ////
+////  rc522_level(sel,uid,pos)  One cascade level in two halves: the   ////
+////  rc522_sak()               first runs anticollision, stores the   ////
+////                            uid bytes at uid+pos and starts the    ////
+////                            select frame without waiting; the      ////
+////                            second collects the SAK.  The uid can  ////
+////                            be worked on while the select is on    ////
+////                            air.  rc522_level returns the new uid  ////
+////                            length or RC_FAIL.                     ////
+////                                                                   ////
+////  CRC_A is computed in software while bytes go through the FIFO,   ////
+////  so there is no separate CalcCRC round trip over SPI.             ////
+///////////////////////////////////////////////////////////////////////////
+
+#define RC_COMMANDREG      0x01
+#define RC_COMIRQREG       0x04
+#define RC_ERRORREG        0x06
+#define RC_FIFODATAREG     0x09
+#define RC_FIFOLEVELREG    0x0A
+#define RC_BITFRAMINGREG   0x0D
+
+#define RC_IDLE            0x00
+#define RC_TRANSCEIVE      0x0C
+
+#define RC_RXIRQ           0x20
+#define RC_IDLEIRQ         0x10
+#define RC_ERRIRQ          0x02
+#define RC_TIMERIRQ        0x01
+#define RC_ERRMASK         0x1B     // overflow, collision, parity, protocol
+
+#define RC_FAIL            0xFF
+
+#ifndef RC522_WAIT
+   #define RC522_WAIT      2000     // idle polls before giving up on a frame
+#endif
+#define RC522_FRAME        128      // longest frame a card may send (FSD)
+
+int16 rc_crc;
+
+void rc_crc_byte(BYTE b)
+{
+   b ^= make8(rc_crc,0);
+   b ^= b << 4;
+   rc_crc = (rc_crc >> 8) ^ ((int16)b << 8) ^ ((int16)b << 3) ^ (b >> 4);
+}
+
+void rc522_open(void)
+{
+   MFRC522_Wr(RC_COMMANDREG, RC_IDLE);
+   MFRC522_Wr(RC_COMIRQREG, 0x7F);
+   MFRC522_Wr(RC_FIFOLEVELREG, 0x80);           // flush
+   rc_crc = 0x6363;
+}
+
+void rc522_put(char *tx, BYTE len)
+{
+   while(len--)                         // @wcet 16: longest frame sent is 12
+   {
+      rc_crc_byte(*tx);
+      MFRC522_Wr(RC_FIFODATAREG, *tx++);
+   }
+}
+
+void rc522_go(int1 crc)
+{
+   if(crc)
+   {
+      MFRC522_Wr(RC_FIFODATAREG, make8(rc_crc,0));
+      MFRC522_Wr(RC_FIFODATAREG, make8(rc_crc,1));
+   }
+   MFRC522_Wr(RC_BITFRAMINGREG, 0x00);
+   MFRC522_Wr(RC_COMMANDREG, RC_TRANSCEIVE);
+   MFRC522_Wr(RC_BITFRAMINGREG, 0x80);          // StartSend
+}
+
+void rc522_start(char *tx, BYTE len, int1 crc)
+{
+   rc522_open();
+   rc522_put(tx, len);
+   rc522_go(crc);
+}
+
+BYTE rc522_finish(char *rx, BYTE max, int1 crc)
+{
+   int16 wait = RC522_WAIT;
+   BYTE n, irq, c, got = 0;
+   int1 fail = 0;
+
+   // a byte arrives at most every two polls while a frame is coming in,
+   // so only the waits before and after it count against RC522_WAIT
+   rc_crc = 0x6363;
+   for(;;)                              // @wcet RC522_WAIT+2*RC522_FRAME
+   {
+      // read the flags first: once RxIRq is seen the level read after it
+      // covers the whole frame
+      irq = MFRC522_Rd(RC_COMIRQREG);
+      n = MFRC522_Rd(RC_FIFOLEVELREG) & 0x7F;
+      if(n)
+         wait = RC522_WAIT;
+      while(n--)                        // @wcet RC522_FRAME total
+      {
+         c = MFRC522_Rd(RC_FIFODATAREG);
+         if(crc)
+            rc_crc_byte(c);
+         if(got < max)
+            rx[got++] = c;
+         else
+            fail = 1;
+      }
+      if(irq & (RC_RXIRQ|RC_ERRIRQ|RC_TIMERIRQ))
+         break;
+      if(!--wait)
+      {
+         fail = 1;
+         break;
+      }
+   }
+   MFRC522_Wr(RC_COMMANDREG, RC_IDLE);
+
+   if(fail || !(irq & RC_RXIRQ) || (MFRC522_Rd(RC_ERRORREG) & RC_ERRMASK))
+      return(RC_FAIL);
+   if(crc)
+   {
+      if(got < 2 || rc_crc != 0)          // CRC_A residue over data+CRC is 0
+         return(RC_FAIL);
+      got -= 2;
+   }
+   return(got);
+}
+
+BYTE rc522_level(BYTE sel, char uid[], BYTE pos)
+{
+   char frame[7];                       // anticollision answer, select frame
+   BYTE i;
+
+   frame[0] = sel;
+   frame[1] = 0x20;                     // NVB: anticollision, no uid bits
+   rc522_start(frame, 2, 0);
+   if(rc522_finish(frame+2, 5, 0) != 5)
+      return(RC_FAIL);
+   if((frame[2]^frame[3]^frame[4]^frame[5]) != frame[6])
+      return(RC_FAIL);
+
+   i = (sel == 0x93 && frame[2] == 0x88) ? 3 : 2;      // drop cascade tag
+   for(; i<6; ++i)
+      uid[pos++] = frame[i];
+
+   frame[1] = 0x70;                     // NVB: select, all 40 bits
+   rc522_start(frame, 7, 1);
+   return(pos);
+}
+
+BYTE rc522_sak(void)
+{
+   char buf[3];
+
+   if(rc522_finish(buf, 3, 1) != 1)
+      return(RC_FAIL);
+   return(buf[0]);
+}
+
+BYTE rc522_select(char uid[], BYTE *len)
+{
+   BYTE pos, sak;
+
+   pos = rc522_level(0x93, uid, 0);
+   if(pos == RC_FAIL)
+      return(RC_FAIL);
+   sak = rc522_sak();
+   if(sak != RC_FAIL && (sak & 0x04))    // uid continues at level 2
+   {
+      pos = rc522_level(0x95, uid, pos);
+      if(pos == RC_FAIL)
+         return(RC_FAIL);
+      sak = rc522_sak();
+   }
+   *len = pos;
+   return(sak);
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////
+////                              RTC.C                                ////
+////        DS1307 / DS3231 clock with a RAM copy kept by its SQW      ////
+////                                                                   ////
+////  rtc_init()        Turn on the 1 Hz square wave, read the time    ////
+////                    and start counting edges on RB0 (INT_EXT).     ////
+////                    Call after wgi_init(), which sets WPUB         ////
+////                    outright.                                      ////
+////                                                                   ////
+////  rtc_poll()        Call from the main loop.  Re-reads the chip    ////
+////                    when the copy is due: every RTC_SYNC_MIN       ////
+////                    minutes and at midnight, when the date         ////
+////                    changes.                                       ////
+////                                                                   ////
+////  rtc_get(&t)       Copy of the current time.  RAM only.           ////
+////                                                                   ////
+////  rtc_ok            FALSE after a read the chip did not answer.    ////
+////                                                                   ////
+////  The square wave ISR only counts seconds, minutes and hours; the  ////
+////  calendar is always taken from the chip.  The clock must run in   ////
+////  24 hour mode.  Define RTC_DS3231 for that chip.                  ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef RTC_SDA
+   #define RTC_SDA        PIN_A1
+   #define RTC_SCL        PIN_A2
+#endif
+#ifndef RTC_SYNC_MIN
+   #define RTC_SYNC_MIN   60       // minutes between drift corrections
+#endif
+
+#ifdef __PCM__
+#byte RTC_WPUB = getenv("SFR:WPUB")
+
+#use i2c(MASTER, SDA=RTC_SDA, SCL=RTC_SCL, SLOW, FORCE_SW)
+#else
+#define RTC_WPUB WPUB
+#endif
+
+#define RTC_ADDR          0xD0
+#ifdef RTC_DS3231
+   #define RTC_CTRL_REG   0x0E
+   #define RTC_CTRL_1HZ   0x00     // INTCN off, RS2:RS1 = 1 Hz
+#else
+   #define RTC_CTRL_REG   0x07
+   #define RTC_CTRL_1HZ   0x10     // SQWE on, RS1:RS0 = 1 Hz
+#endif
+
+typedef struct
+{
+   BYTE sec, min, hour;             // binary, 24 hour
+   BYTE dow, day, mon, year;        // dow 1-7, year 0-99
+} RTC_TIME;
+
+RTC_TIME rtc;
+BYTE rtc_age;                       // minutes since the chip was read
+int1 rtc_stale = 1;                 // copy must be re-read
+int1 rtc_ok = 0;
+
+BYTE rtc_bin(BYTE bcd)
+{
+   return((bcd >> 4)*10 + (bcd & 0x0F));
+}
+
+void rtc_write(BYTE reg, BYTE val)
+{
+   i2c_start();
+   i2c_write(RTC_ADDR);
+   i2c_write(reg);
+   i2c_write(val);
+   i2c_stop();
+}
+
+// Read the time registers into the copy.  The edge interrupt is held
+// off and its flag cleared first: the chip latches its registers at the
+// START, so an edge during the read is counted on top of the old value.
+int1 rtc_read(void)
+{
+   BYTE b[7], i;
+
+   disable_interrupts(INT_EXT);
+   clear_interrupt(INT_EXT);
+   i2c_start();
+   if(i2c_write(RTC_ADDR))          // no ACK
+   {
+      i2c_stop();
+      enable_interrupts(INT_EXT);
+      return(FALSE);
+   }
+   i2c_write(0);
+   i2c_start();
+   i2c_write(RTC_ADDR | 1);
+   for(i=0;i<7;++i)
+      b[i] = i2c_read(i < 6);
+   i2c_stop();
+
+   rtc.sec  = rtc_bin(b[0] & 0x7F);
+   rtc.min  = rtc_bin(b[1]);
+   rtc.hour = rtc_bin(b[2] & 0x3F);
+   rtc.dow  = b[3] & 0x07;
+   rtc.day  = rtc_bin(b[4] & 0x3F);
+   rtc.mon  = rtc_bin(b[5] & 0x1F);   // DS3231 keeps the century in bit 7
+   rtc.year = rtc_bin(b[6]);
+   rtc_age = 0;
+   enable_interrupts(INT_EXT);
+
+   if(b[0] & 0x80)                  // DS1307 oscillator halted
+      rtc_write(0, b[0] & 0x7F);
+   return(TRUE);
+}
+
+#ifdef __PCM__
+#int_ext
+#endif
+void rtc_isr(void)
+{
+   ISR_ENTER();
+   if(++rtc.sec >= 60)
+   {
+      rtc.sec = 0;
+      if(++rtc_age >= RTC_SYNC_MIN)
+         rtc_stale = 1;
+      if(++rtc.min >= 60)
+      {
+         rtc.min = 0;
+         if(++rtc.hour >= 24)
+         {
+            rtc.hour = 0;
+            rtc_stale = 1;            // new date comes from the chip
+         }
+      }
+   }
+   ISR_LEAVE(ISR_EXT);
+}
+
+void rtc_poll(void)
+{
+   if(rtc_stale)
+   {
+      rtc_ok = rtc_read();
+      rtc_stale = 0;                // a dead chip is retried next sync
+      rtc_age = 0;
+   }
+}
+
+void rtc_get(RTC_TIME *t)
+{
+   disable_interrupts(INT_EXT);
+   *t = rtc;
+   enable_interrupts(INT_EXT);
+}
+
+void rtc_init(void)
+{
+   port_b_pullups(RTC_WPUB | 0x01);  // SQW is open drain
+   rtc_write(RTC_CTRL_REG, RTC_CTRL_1HZ);
+   rtc_ok = rtc_read();
+   rtc_stale = 0;
+   ext_int_edge(H_TO_L);
+   clear_interrupt(INT_EXT);
+   enable_interrupts(INT_EXT);
+}
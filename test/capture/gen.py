@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Writes the synthetic captures in this directory.
+
+The edges follow what code1.c drives on a tap with MARK_PIN defined:
+- a marker pulse when the card is seen;
+- reader chip selects;
+- a double marker when the decision is made;
+- the strike relay, the LCD write burst and the buzzer pulses of
+  bipbip().
+
+taps.csv is in the form sigrok-cli -O csv:time=true:dedup=true writes:
+a time column, with a row only where a level changes.  decide.csv is a
+plain export with one row per sample at 5 MHz and no time column; its
+only channels are the marker and the LCD enable.
+
+    python3 gen.py        (rewrites taps.csv and decide.csv)
+"""
+
+CH = ['D1', 'D3', 'D5', 'C0', 'C1']     # mark cs en buz relay
+
+
+def pulse(ev, ch, t, width):
+    ev.append((t, ch, 1))
+    ev.append((t + width, ch, 0))
+
+
+def marker(ev, t, n):
+    for i in range(n):
+        pulse(ev, 'D1', t + i * 2e-6, 1e-6)
+
+
+def lcd(ev, t, n):
+    for i in range(n):                  # one enable pulse per nibble
+        pulse(ev, 'D5', t + i * 45e-6, 1e-6)
+
+
+def tap(ev, t, decide, relay, beeps, on, off):
+    marker(ev, t, 1)
+    for i in range(6):                  # reader frames
+        pulse(ev, 'D3', t + 20e-6 + i * 250e-6, 180e-6)
+    marker(ev, t + decide, 2)
+    x = t + decide + 10e-6
+    if relay is not None:
+        ev.append((x, 'C1', relay))
+        x += 5e-6
+    lcd(ev, x, 32)
+    x += 32 * 45e-6 + 20e-6
+    for i in range(beeps):
+        pulse(ev, 'C0', x, on)
+        x += on + off
+
+
+def taps():
+    ev = []
+    tap(ev, 0.100, 1.62e-3, 1, 3, 3e-3, 10e-3)       # grant, door opens
+    tap(ev, 1.300, 1.58e-3, None, 10, 10e-3, 10e-3)  # unknown badge
+    tap(ev, 2.900, 1.71e-3, 0, 3, 3e-3, 10e-3)       # grant, door closes
+    tap(ev, 4.200, 2.05e-3, 1, 3, 3e-3, 10e-3)
+    ev.sort()
+    level = dict.fromkeys(CH, 0)
+    with open('taps.csv', 'w') as f:
+        f.write('; CSV, generated by libsigrok 0.5.2\n')
+        f.write('; Channels (5/8): %s\n' % ', '.join(CH))
+        f.write('; Samplerate: 5 MHz\n')
+        f.write('Time,%s\n' % ','.join(CH))
+        f.write('0.0000000,%s\n' % ','.join('0' for c in CH))
+        for i, (t, ch, v) in enumerate(ev):
+            level[ch] = v
+            if i + 1 < len(ev) and abs(ev[i + 1][0] - t) < 1e-9:
+                continue                # same sample: one row
+            f.write('%.7f,%s\n' % (t, ','.join(str(level[c]) for c in CH)))
+        f.write('%.7f,%s\n' % (5.0, ','.join(str(level[c]) for c in CH)))
+
+
+def decide():
+    ev = []
+    marker(ev, 100e-6, 1)
+    marker(ev, 100e-6 + 1.43e-3, 2)
+    lcd(ev, 100e-6 + 1.45e-3, 16)
+    rate = 5e6
+    n = int(2.5e-3 * rate)
+    rows = [[0, 0] for i in range(n)]
+    for t, ch, v in ev:
+        k = int(round(t * rate))
+        for r in rows[k:]:
+            r[0 if ch == 'D1' else 1] = v
+    with open('decide.csv', 'w') as f:
+        f.write('; Samplerate: 5 MHz\n')
+        f.write('D1,D5\n')
+        for r in rows:
+            f.write('%d,%d\n' % tuple(r))
+
+
+if __name__ == '__main__':
+    taps()
+    decide()
@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////////
+////                           HD44780.C                               ////
+////          Nibble-level HD44780 model for the host tests            ////
+////                                                                   ////
+////  Include after host.h and before lcd.c, then call hd_reset().     ////
+////  The model sits on the code1.c LCD pins and follows the bus the   ////
+////  way the controller does: data is latched on the falling edge     ////
+////  of E, a read nibble is driven from the rising edge, 8-bit mode   ////
+////  until a function set with DL=0, and every instruction keeps the  ////
+////  busy flag up for its datasheet execution time (37us, 1.52ms     ////
+////  for clear and home) measured in host_cycles.                     ////
+////                                                                   ////
+////  hd_lost        transfers the controller ignored: written while   ////
+////                 busy, or a data read while busy                   ////
+////  hd_violations  enable pulses shorter than 450ns or E cycles      ////
+////                 shorter than 1us                                  ////
+////  hd_dead        no display: the bus floats high                   ////
+////  hd_stuck_bf    the DB7 read path is stuck high, so the busy      ////
+////                 flag never clears but writes still land           ////
+////  hd_glitch()    what ESD does: back in 8-bit mode, address lost   ////
+////                                                                   ////
+////  With HD_TRACE defined, LCD_TRACE events go to hd_trace_file as   ////
+////  one line each (see lcddiff.py).                                  ////
+///////////////////////////////////////////////////////////////////////////
+
+#define LCD_ENABLE_PIN     PIN_D5
+#define LCD_RS_PIN         PIN_D7
+#define LCD_RW_PIN         PIN_D6
+#define LCD_DATA4          PIN_D4
+#define LCD_DATA5          PIN_C7
+#define LCD_DATA6          PIN_C6
+#define LCD_DATA7          PIN_C5
+
+#define HD_EXEC         (37 * HOST_MHZ)
+#define HD_EXEC_HOME    (1520 * HOST_MHZ)
+#define HD_POWER_UP     (10000 * HOST_MHZ)   // internal reset after Vcc
+
+BYTE hd_ddram[128];
+BYTE hd_cgram[64];
+BYTE hd_ac;
+int1 hd_cg;                         // address counter is in CGRAM
+int1 hd_four;                       // 4-bit interface
+int1 hd_second;                     // next nibble is the low one
+BYTE hd_hold;                       // high nibble of a write
+BYTE hd_read;                       // byte being read
+BYTE hd_nibble;                     // nibble driven on DB7..DB4
+BYTE hd_display;                    // last display on/off control
+uint64_t hd_busy_until, hd_rise, hd_last_rise;
+int hd_lost, hd_violations, hd_writes, hd_instructions;
+int1 hd_dead, hd_stuck_bf;
+
+#ifdef HD_TRACE
+FILE *hd_trace_file;
+const char *const HD_TRACE_NAME[5] = {"en", "rs", "rw", "w", "r"};
+
+void hd_trace(int what, int x)
+{
+   if(hd_trace_file)
+      fprintf(hd_trace_file, "%s %X\n", HD_TRACE_NAME[what], x & 0xF);
+}
+#define LCD_TRACE(line,x)  hd_trace(line, x)
+#endif
+
+BYTE hd_pin(BYTE p)
+{
+   return((host_port[HOST_REG(p)] & HOST_MASK(p)) != 0);
+}
+
+BYTE hd_next(BYTE a)
+{
+   if(hd_cg)
+      return((a + 1) & 0x3F);
+   if(a == 0x27)
+      return(0x40);
+   if(a == 0x67)
+      return(0x00);
+   return((a + 1) & 0x7F);           // past either line: not specified
+}
+
+int1 hd_busy(void)
+{
+   return(host_cycles < hd_busy_until);
+}
+
+void hd_execute(int1 rs, BYTE v)
+{
+   if(hd_busy())
+   {
+      ++hd_lost;
+      return;
+   }
+   hd_busy_until = host_cycles + HD_EXEC;
+   if(rs)
+   {
+      if(hd_cg)
+         hd_cgram[hd_ac] = v;
+      else
+         hd_ddram[hd_ac] = v;
+      hd_ac = hd_next(hd_ac);
+      ++hd_writes;
+      return;
+   }
+   ++hd_instructions;
+   if(v & 0x80)
+   {
+      hd_cg = 0;
+      hd_ac = v & 0x7F;
+   }
+   else if(v & 0x40)
+   {
+      hd_cg = 1;
+      hd_ac = v & 0x3F;
+   }
+   else if(v & 0x20)
+   {
+      if(!(v & 0x10) && !hd_four)
+      {
+         hd_four = 1;
+         hd_second = 0;
+      }
+   }
+   else if(v & 0x10)
+   {
+      if(!(v & 0x08))                   // cursor, not display, shift
+      {
+         if(v & 0x04)
+            hd_ac = hd_next(hd_ac);
+         else if(hd_cg)
+            hd_ac = (hd_ac - 1) & 0x3F;
+         else
+            hd_ac = hd_ac == 0x40 ? 0x27 : hd_ac == 0 ? 0x67 : hd_ac - 1;
+      }
+   }
+   else if(v & 0x08)
+      hd_display = v;
+   else if(v & 0x04)
+      ;                                 // entry mode, increment assumed
+   else if(v & 0x02)
+   {
+      hd_cg = 0;
+      hd_ac = 0;
+      hd_busy_until = host_cycles + HD_EXEC_HOME;
+   }
+   else if(v & 0x01)
+   {
+      memset(hd_ddram, ' ', sizeof(hd_ddram));
+      hd_cg = 0;
+      hd_ac = 0;
+      hd_busy_until = host_cycles + HD_EXEC_HOME;
+   }
+}
+
+BYTE hd_data_in(void)
+{
+   return(hd_pin(LCD_DATA4) | hd_pin(LCD_DATA5) << 1 |
+          hd_pin(LCD_DATA6) << 2 | hd_pin(LCD_DATA7) << 3);
+}
+
+void hd_edge(BYTE p, BYTE v)
+{
+   BYTE n;
+
+   if(p != LCD_ENABLE_PIN || hd_dead)
+      return;
+   if(v)
+   {
+      if(hd_rise && host_cycles - hd_last_rise < 5)
+         ++hd_violations;               // tcycE 1000ns
+      hd_last_rise = hd_rise = host_cycles;
+      if(!hd_pin(LCD_RW_PIN))
+         return;
+      if(!hd_four || !hd_second)
+      {
+         if(!hd_pin(LCD_RS_PIN))
+            hd_read = (hd_busy() ? 0x80 : 0) | hd_ac;
+         else if(hd_busy())
+         {
+            ++hd_lost;
+            hd_read = 0xFF;
+         }
+         else
+            hd_read = hd_cg ? hd_cgram[hd_ac] : hd_ddram[hd_ac];
+         if(hd_stuck_bf && !hd_pin(LCD_RS_PIN))
+            hd_read |= 0x80;
+         hd_nibble = hd_read >> 4;
+      }
+      else
+         hd_nibble = hd_read & 0x0F;
+      if(hd_four)
+         hd_second = !hd_second;
+      if((!hd_four || !hd_second) && hd_pin(LCD_RS_PIN) && !hd_busy())
+         hd_ac = hd_next(hd_ac);
+      return;
+   }
+
+   if(host_cycles - hd_rise < 3)
+      ++hd_violations;                  // PWEH 450ns
+   if(hd_pin(LCD_RW_PIN))
+      return;
+   n = hd_data_in();
+   if(!hd_four)
+      hd_execute(hd_pin(LCD_RS_PIN), n << 4);
+   else if(!hd_second)
+   {
+      hd_hold = n;
+      hd_second = 1;
+   }
+   else
+   {
+      hd_second = 0;
+      hd_execute(hd_pin(LCD_RS_PIN), hd_hold << 4 | n);
+   }
+}
+
+BYTE hd_input(BYTE p)
+{
+   if(hd_dead)
+      return(1);
+   if(p == LCD_DATA4)
+      return(bit_test(hd_nibble,0));
+   if(p == LCD_DATA5)
+      return(bit_test(hd_nibble,1));
+   if(p == LCD_DATA6)
+      return(bit_test(hd_nibble,2));
+   if(p == LCD_DATA7)
+      return(bit_test(hd_nibble,3));
+   return(hd_pin(p));
+}
+
+// Power up with RAM holding junk, as a real module does
+void hd_reset(void)
+{
+   memset(hd_ddram, '?', sizeof(hd_ddram));
+   memset(hd_cgram, 0, sizeof(hd_cgram));
+   hd_ac = 0;
+   hd_cg = hd_four = hd_second = 0;
+   hd_display = 0;
+   hd_busy_until = host_cycles + HD_POWER_UP;
+   hd_rise = hd_last_rise = 0;
+   hd_lost = hd_violations = hd_writes = hd_instructions = 0;
+   hd_dead = hd_stuck_bf = 0;
+   host_edge = hd_edge;
+   host_input = hd_input;
+}
+
+void hd_glitch(void)
+{
+   hd_four = hd_second = 0;
+   hd_ac = 0x12;
+   memset(hd_ddram, 'x', sizeof(hd_ddram));
+}
+
+// Line y (1 or 2) of a 16 column display, as a C string
+char *hd_line(BYTE y)
+{
+   static char s[2][17];
+
+   memcpy(s[y-1], hd_ddram + (y == 1 ? 0 : 0x40), 16);
+   s[y-1][16] = 0;
+   return(s[y-1]);
+}
@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////
+////                             HOST.H                                ////
+////          CCS built-ins for the host test programs                 ////
+////                                                                   ////
+////  The tests in this directory include the firmware modules         ////
+////  straight into a gcc program.  This file stands in for the        ////
+////  device header and the CCS built-ins, with:                       ////
+////                                                                   ////
+////  host_cycles   instruction cycles at 20 MHz.  Delays add their    ////
+////                length and every pin access one cycle, so a test   ////
+////                can time a bus sequence.                           ////
+////  host_edge     called when an output pin changes                  ////
+////  host_input    level of an input pin, NULL reads the latch        ////
+////  host_nv       called before every EEPROM or flash word write,    ////
+////                where a test can cut the power (longjmp).          ////
+////                host_nv_ee / host_nv_flash point at the byte or    ////
+////                word about to be written, the other one is NULL,   ////
+////                so a test can also leave it half written.          ////
+////  host_ee[]     data EEPROM, host_flash[] program memory, both     ////
+////                erased by host_reset().  Program memory reads      ////
+////                cost the cycles of the EECON sequence.             ////
+////                                                                   ////
+////  Pins are numbered as in the CCS device header (and compat.h):    ////
+////  register address * 8 + bit.                                      ////
+///////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define BYTE            uint8_t
+#define int1            uint8_t
+#define int8            uint8_t
+#define int16           uint16_t
+#define int32           uint32_t
+#define BOOLEAN         uint8_t
+#define TRUE            1
+#define FALSE           0
+
+#define PIN_A0  40
+#define PIN_A1  41
+#define PIN_A2  42
+#define PIN_A3  43
+#define PIN_A4  44
+#define PIN_A5  45
+#define PIN_B0  48
+#define PIN_B1  49
+#define PIN_B2  50
+#define PIN_B3  51
+#define PIN_B4  52
+#define PIN_B5  53
+#define PIN_B6  54
+#define PIN_B7  55
+#define PIN_C0  56
+#define PIN_C1  57
+#define PIN_C2  58
+#define PIN_C3  59
+#define PIN_C4  60
+#define PIN_C5  61
+#define PIN_C6  62
+#define PIN_C7  63
+#define PIN_D0  64
+#define PIN_D1  65
+#define PIN_D2  66
+#define PIN_D3  67
+#define PIN_D4  68
+#define PIN_D5  69
+#define PIN_D6  70
+#define PIN_D7  71
+#define PIN_E0  72
+#define PIN_E1  73
+#define PIN_E2  74
+
+#define HOST_MHZ        5              // instruction cycles per us
+
+uint64_t host_cycles;
+BYTE host_port[5], host_tris[5], host_wpub;
+void (*host_edge)(BYTE pin, BYTE v);
+BYTE (*host_input)(BYTE pin);
+void (*host_nv)(void);
+BYTE *host_nv_ee;
+int16 *host_nv_flash;
+
+#define PORTA           host_port[0]
+#define PORTB           host_port[1]
+#define PORTC           host_port[2]
+#define PORTD           host_port[3]
+#define PORTE           host_port[4]
+#define TRISA           host_tris[0]
+#define TRISB           host_tris[1]
+#define TRISC           host_tris[2]
+#define TRISD           host_tris[3]
+#define TRISE           host_tris[4]
+#define WPUB            host_wpub
+
+#define HOST_REG(p)     (((p) >> 3) - 5)
+#define HOST_MASK(p)    (1 << ((p) & 7))
+
+void output_bit(BYTE p, BYTE v)
+{
+   BYTE was = host_port[HOST_REG(p)] & HOST_MASK(p);
+
+   ++host_cycles;
+   host_tris[HOST_REG(p)] &= ~HOST_MASK(p);
+   if(v)
+      host_port[HOST_REG(p)] |= HOST_MASK(p);
+   else
+      host_port[HOST_REG(p)] &= ~HOST_MASK(p);
+   if(host_edge && !was != !v)
+      host_edge(p, v != 0);
+}
+
+#define output_high(p)  output_bit(p, 1)
+#define output_low(p)   output_bit(p, 0)
+#define output_drive(p) (++host_cycles, host_tris[HOST_REG(p)] &= ~HOST_MASK(p))
+#define output_float(p) (++host_cycles, host_tris[HOST_REG(p)] |= HOST_MASK(p))
+
+BYTE input(BYTE p)
+{
+   ++host_cycles;
+   host_tris[HOST_REG(p)] |= HOST_MASK(p);
+   if(host_input)
+      return(host_input(p) != 0);
+   return((host_port[HOST_REG(p)] & HOST_MASK(p)) != 0);
+}
+
+#define delay_cycles(n) (host_cycles += (n))
+#define delay_us(n)     (host_cycles += (uint64_t)(n) * HOST_MHZ)
+#define delay_ms(n)     (host_cycles += (uint64_t)(n) * HOST_MHZ * 1000)
+
+#define bit_test(x,b)   (((x) >> (b)) & 1)
+#define bit_set(x,b)    ((x) |= (1UL << (b)))
+#define bit_clear(x,b)  ((x) &= ~(1UL << (b)))
+#define make8(x,n)      ((BYTE)((x) >> (8*(n))))
+#define make16(h,l)     ((int16)(((int16)(BYTE)(h) << 8) | (BYTE)(l)))
+#define make32(a,b,c,d) (((int32)make16(a,b) << 16) | make16(c,d))
+
+// Shift an n byte field one bit; the CCS argument order
+BYTE shift_left(void *p, BYTE n, BYTE in)
+{
+   BYTE *b = (BYTE *)p, i, out = b[n-1] >> 7;
+
+   for(i=n-1;i>0;--i)
+      b[i] = (b[i] << 1) | (b[i-1] >> 7);
+   b[0] = (b[0] << 1) | (in & 1);
+   return(out);
+}
+
+BYTE shift_right(void *p, BYTE n, BYTE in)
+{
+   BYTE *b = (BYTE *)p, i, out = b[0] & 1;
+
+   for(i=0;i<n-1;++i)
+      b[i] = (b[i] >> 1) | (b[i+1] << 7);
+   b[n-1] = (b[n-1] >> 1) | (in << 7);
+   return(out);
+}
+
+// Interrupts: the enable bits only, the tests call the handlers
+#define GLOBAL          0x80
+#define INT_TIMER2      0x01
+#define INT_RTCC        0x02
+#define INT_RB          0x04
+#define INT_EXT         0x08
+#define INT_EXT_H2L     0x10
+#define INT_RB4         0x04
+#define INT_RB5         0x04
+#define H_TO_L          0
+#define L_TO_H          1
+
+BYTE host_ie;
+
+#define enable_interrupts(i)  (host_ie |= (BYTE)(i))
+#define disable_interrupts(i) (host_ie &= (BYTE)~(i))
+#define clear_interrupt(i)
+#define ext_int_edge(e)
+#define port_b_pullups(m)     (host_wpub = (m))
+#define set_tris_b(m)         (host_tris[1] = (m))
+
+// Timers: the tests set 0 and 2, timer 1 counts instruction cycles
+BYTE host_tmr0, host_tmr2;
+
+#define RTCC_INTERNAL   0
+#define RTCC_DIV_8      2
+#define RTCC_DIV_16     3
+#define T1_INTERNAL     0x01
+#define T1_DIV_BY_1     0x00
+#define T2_DIV_BY_4     0x05
+#define setup_timer_0(m)
+#define setup_timer_1(m)
+#define setup_timer_2(m,p,s)
+#define get_timer0()    host_tmr0
+#define get_timer1()    ((int16)host_cycles)   // Fosc/4, 1:1
+#define get_timer2()    host_tmr2
+#define set_timer0(v)   (host_tmr0 = (v))
+
+// Non-volatile memory
+BYTE host_ee[256];
+int16 host_flash[0x2000];
+
+BYTE read_eeprom(BYTE a)
+{
+   return(host_ee[a]);
+}
+
+void write_eeprom(BYTE a, BYTE v)
+{
+   host_nv_ee = &host_ee[a];
+   host_nv_flash = NULL;
+   if(host_nv)
+      host_nv();
+   host_ee[a] = v;
+   host_cycles += 4000 * HOST_MHZ;     // 4ms write
+}
+
+// EEADR/EEADRH, EEPGD, RD and the two NOPs, EEDAT/EEDATH
+#define HOST_FLASH_READ 10
+
+int16 read_program_eeprom(int16 a)
+{
+   host_cycles += HOST_FLASH_READ;
+   return(host_flash[a & 0x1FFF]);
+}
+
+void read_program_memory(int16 a, BYTE *p, BYTE n)
+{
+   for(; n; n-=2, ++a)
+   {
+      host_cycles += HOST_FLASH_READ + 4;     // and the loop
+      *p++ = make8(host_flash[a & 0x1FFF],0);
+      *p++ = make8(host_flash[a & 0x1FFF],1);
+   }
+}
+
+// Word by word, so a power cut can leave a row half written
+void write_program_memory(int16 a, BYTE *p, BYTE n)
+{
+   for(; n; n-=2, p+=2, ++a)
+   {
+      host_nv_ee = NULL;
+      host_nv_flash = &host_flash[a & 0x1FFF];
+      if(host_nv)
+         host_nv();
+      host_flash[a & 0x1FFF] = make16(p[1], p[0]) & 0x3FFF;
+      host_cycles += 2000 * HOST_MHZ / 8;
+   }
+}
+
+void host_reset(void)
+{
+   host_cycles = 0;
+   memset(host_port, 0, sizeof(host_port));
+   memset(host_tris, 0xFF, sizeof(host_tris));
+   memset(host_ee, 0xFF, sizeof(host_ee));
+   for(int i=0;i<0x2000;++i)
+      host_flash[i] = 0x3FFF;
+   host_edge = NULL;
+   host_input = NULL;
+   host_nv = NULL;
+   host_ie = 0;
+   host_tmr0 = host_tmr2 = 0;
+}
+
+// Test bookkeeping: CHECK counts failures, run.sh wants exit status 0
+int host_failed;
+
+#define CHECK(c)  do { if(!(c)) { ++host_failed; \
+                     printf("%s:%d: FAILED %s\n", __FILE__, __LINE__, #c); } \
+                  } while(0)
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""First difference between two HD44780 bus traces.
+
+The traces are what lcdtrace writes: "bits 4" or "bits 8" for the
+interface width at the start, then one LCD_TRACE event per line, "en",
+"rs" or "rw" with the new level, "w" with the nibble the PIC drove, "r"
+with the nibble the display drove.  The events are put back together
+into bus transfers the way the controller sees them (8-bit mode until a
+function set with DL=0, then nibble pairs):
+
+    cmd  28        instruction write
+    data 41 'A'    DDRAM/CGRAM write
+    read 41 'A'    DDRAM/CGRAM read
+    nib  3         8-bit mode write of the upper nibble only
+
+Status reads (busy flag polls) are timing, not protocol: a faster driver
+polls more often, so they are left out unless --exact is given, which
+also compares the raw events one for one.
+
+Prints the first transfer that differs, with the ones before it, and
+exits 1; exits 0 when the traces agree.
+
+usage: lcddiff.py GOLDEN NEW [--exact] [--context N]
+"""
+
+import argparse
+import sys
+
+
+def events(path):
+    out = []
+    for n, line in enumerate(open(path), 1):
+        f = line.split()
+        if len(f) != 2 or f[0] not in ('bits', 'en', 'rs', 'rw', 'w', 'r'):
+            sys.exit('%s:%d: not a trace line' % (path, n))
+        out.append((f[0], int(f[1], 16), n))
+    return out
+
+
+def transfers(evs, exact):
+    """Bus transfers as (text, line of the event that completed it)."""
+    out = []
+    rs = rw = en = 0
+    four, half, nib, got = False, None, 0, []
+    for what, x, n in evs:
+        if what == 'bits':
+            four = x == 4
+        elif what == 'rs':
+            rs = x
+        elif what == 'rw':
+            rw = x
+        elif what == 'w':
+            nib = x
+        elif what == 'r':
+            got.append(x)
+        elif what == 'en':
+            falling = en and not x
+            en = x
+            if not falling:
+                continue
+            if rw:
+                if not four:
+                    got = []
+                    continue
+                if len(got) < 2:
+                    continue
+                b = got[0] << 4 | got[1]
+                got = []
+                if rs:
+                    out.append(('read %02X %s' % (b, show(b)), n))
+                elif exact:
+                    out.append(('status %02X' % b, n))
+                continue
+            if not four:
+                out.append(('nib  %X' % nib, n))
+                if not rs and nib == 2:
+                    four, half = True, None
+                continue
+            if half is None:
+                half = nib
+                continue
+            b, half = half << 4 | nib, None
+            if rs:
+                out.append(('data %02X %s' % (b, show(b)), n))
+            else:
+                out.append(('cmd  %02X' % b, n))
+    return out
+
+
+def show(b):
+    return repr(chr(b)) if 32 <= b < 127 else ''
+
+
+def main():
+    ap = argparse.ArgumentParser(description='compare HD44780 bus traces')
+    ap.add_argument('golden')
+    ap.add_argument('new')
+    ap.add_argument('--exact', action='store_true',
+                    help='compare status reads and raw events too')
+    ap.add_argument('--context', type=int, default=4, metavar='N',
+                    help='transfers shown before the difference')
+    a = ap.parse_args()
+
+    ga, na = events(a.golden), events(a.new)
+    g, m = transfers(ga, a.exact), transfers(na, a.exact)
+    for i in range(max(len(g), len(m))):
+        if i < len(g) and i < len(m) and g[i][0] == m[i][0]:
+            continue
+        print('first difference at transfer %d' % (i + 1))
+        for k in range(max(0, i - a.context), i):
+            print('    %s' % g[k][0])
+        gl = '%-20s  %s:%d' % (g[i][0], a.golden, g[i][1]) if i < len(g) \
+            else '(end)'
+        nl = '%-20s  %s:%d' % (m[i][0], a.new, m[i][1]) if i < len(m) \
+            else '(end)'
+        print('-   %s\n+   %s' % (gl, nl))
+        sys.exit(1)
+    if a.exact:
+        for i, (x, y) in enumerate(zip(ga, na)):
+            if x[:2] != y[:2]:
+                print('first difference at event %d: %s:%d "%s %X", '
+                      '%s:%d "%s %X"' % (i + 1, a.golden, x[2], x[0], x[1],
+                                         a.new, y[2], y[0], y[1]))
+                sys.exit(1)
+        if len(ga) != len(na):
+            print('%s has %d events, %s has %d'
+                  % (a.golden, len(ga), a.new, len(na)))
+            sys.exit(1)
+    sys.exit(0)
+
+
+if __name__ == '__main__':
+    main()
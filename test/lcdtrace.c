@@ -0,0 +1,165 @@
+// Records the HD44780 bus transactions the driver makes for a corpus of
+// screens, one DIR/NAME.trace per screen, and prints the DDRAM each
+// screen leaves.  Fails if the model saw a lost transfer or a timing
+// violation.  golden/ holds the traces of the reference driver; compare
+// a changed driver against them with lcddiff.py (t_lcd_trace.sh does).
+//
+//     lcdtrace DIR
+
+#define HD_TRACE
+#include "host.h"
+#include "hd44780.c"
+#include <lcd.c>
+#include <msg.c>
+
+void puts_lcd(const char *s)
+{
+   while(*s)
+      lcd_putc(*s++);
+}
+
+// Line y with the CGRAM characters as digits
+char *shown(BYTE y)
+{
+   char *s = hd_line(y);
+   BYTE i;
+
+   for(i=0;i<16;++i)
+      if(s[i] < 8)
+         s[i] += '0';
+   return(s);
+}
+
+void s_init(void)
+{
+   lcd_init();
+}
+
+// code1.c main() up to the first card poll
+void s_boot(void)
+{
+   lcd_gotoxy(0,1);
+   msg_puts(MSG_TITLE);
+   lcd_gotoxy(6,2);
+   msg_puts(MSG_GROUP);
+   msg_puts(MSG_INIT);
+   msg_puts(MSG_DONE);
+   msg_puts(MSG_SCAN);
+}
+
+// MO_CUA()
+void s_grant(void)
+{
+   msg_puts(MSG_TRUNG);
+   lcd_gotoxy(0,2);
+   msg_puts(MSG_WELCOME);
+}
+
+void s_closed(void)
+{
+   msg_puts(MSG_MEMBER);
+   lcd_gotoxy(0,2);
+   msg_puts(MSG_CLOSED);
+}
+
+// XU_LY() refusal
+void s_deny(void)
+{
+   lcd_gotoxy(0,1);
+   msg_puts(MSG_INVALID);
+   lcd_gotoxy(4,2);
+   msg_puts(MSG_WARNING);
+}
+
+void s_prov(void)
+{
+   msg_puts(MSG_PROV);
+}
+
+void s_edit(void)
+{
+   puts_lcd("\fabcd\b\bX\nline two\b!");
+}
+
+// past the end of both lines: 0x27 -> 0x40 and 0x67 -> 0x00
+void s_wrap(void)
+{
+   BYTE i;
+
+   lcd_putc('\f');
+   for(i=0;i<90;++i)
+      lcd_putc('0' + i % 43);
+}
+
+void s_getc(void)
+{
+   BYTE i;
+   char c[4];
+
+   puts_lcd("\fXin moi\nquet the");
+   for(i=0;i<4;++i)
+      c[i] = lcd_getc(i+1, i & 1 ? 2 : 1);
+   lcd_gotoxy(12,1);
+   for(i=0;i<4;++i)
+      lcd_putc(c[i]);
+}
+
+void s_cgram(void)
+{
+   BYTE i;
+
+   lcd_send_byte(0,0x40);
+   for(i=0;i<16;++i)
+      lcd_send_byte(1,i * 3);
+   lcd_putc('\f');
+   lcd_putc(1);
+   lcd_putc(0);
+   puts_lcd("ok");
+}
+
+struct
+{
+   const char *name;
+   void (*show)(void);
+} const SCREEN[] = {
+   {"init", s_init}, {"boot", s_boot}, {"grant", s_grant},
+   {"closed", s_closed}, {"deny", s_deny}, {"prov", s_prov},
+   {"edit", s_edit}, {"wrap", s_wrap}, {"getc", s_getc},
+   {"cgram", s_cgram}};
+
+int main(int argc, char **argv)
+{
+   char path[256];
+   unsigned i;
+
+   if(argc != 2)
+   {
+      fprintf(stderr, "usage: lcdtrace DIR\n");
+      return(2);
+   }
+   for(i=0;i<sizeof(SCREEN)/sizeof(SCREEN[0]);++i)
+   {
+      host_reset();
+      hd_reset();
+      if(SCREEN[i].show != s_init)
+         lcd_init();
+      snprintf(path, sizeof(path), "%s/%s.trace", argv[1], SCREEN[i].name);
+      hd_trace_file = fopen(path, "w");
+      if(!hd_trace_file)
+      {
+         perror(path);
+         return(2);
+      }
+      fprintf(hd_trace_file, "bits %d\n", hd_four ? 4 : 8);
+      SCREEN[i].show();
+      fclose(hd_trace_file);
+      hd_trace_file = NULL;
+      printf("%-7s [%s]", SCREEN[i].name, shown(1));
+      printf(" [%s]\n", shown(2));
+      if(hd_lost || hd_violations)
+         printf("%-7s %d lost, %d timing violations\n", SCREEN[i].name,
+                hd_lost, hd_violations);
+      CHECK(hd_lost == 0 && hd_violations == 0);
+   }
+   return(host_failed != 0);
+}
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Host tests: builds every t_*.c here with gcc against host.h and runs it.
+# A test with a t_NAME.out file must print exactly that.  A t_NAME.sh
+# runs instead, with $HOSTCC and a scratch directory $OUT.  Run from
+# anywhere; exits non-zero if a test fails.
+#
+#     sh test/run.sh [NAME...]
+
+cd "$(dirname "$0")" || exit 1
+out=${TMPDIR:-/tmp}/codetest.$$
+mkdir -p "$out"
+trap 'rm -rf "$out"' EXIT
+HOSTCC="${CC:-gcc} -std=gnu99 -funsigned-char -O1 \
+   -Werror=implicit-function-declaration -I. -I.."
+export HOSTCC
+fail=0
+
+tests=$*
+[ -n "$tests" ] || tests=$(ls t_*.c t_*.sh 2>/dev/null | sed 's/\.[a-z]*$//' | sort -u)
+
+for t in $tests; do
+   if [ -f "$t.sh" ]; then
+      mkdir -p "$out/$t.d"
+      OUT="$out/$t.d" sh "./$t.sh" > "$out/$t.txt" 2>&1
+   elif $HOSTCC -o "$out/$t" "$t.c" 2> "$out/$t.cc"; then
+      "$out/$t" > "$out/$t.txt" 2>&1
+   else
+      cat "$out/$t.cc"
+      echo "FAIL $t (build)"
+      fail=1
+      continue
+   fi
+   status=$?
+   if [ $status -eq 0 ] && [ -f "$t.out" ] && ! diff -u "$t.out" "$out/$t.txt" > "$out/$t.diff"; then
+      cat "$out/$t.diff"
+      status=1
+   fi
+   if [ $status -eq 0 ]; then
+      echo "ok   $t"
+   else
+      cat "$out/$t.txt"
+      echo "FAIL $t"
+      fail=1
+   fi
+done
+exit $fail
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////
+////                           BUILT_IN.H                              ////
+////           Scripted MFRC522 in place of the reader library         ////
+////                                                                   ////
+////  The MFRC522 library is not part of this tree.  This stand-in     ////
+////  keeps the calls the firmware makes and answers them at register  ////
+////  level without SPI, so code1.c can be checked by gcc              ////
+////  (test/t_xc8.sh).                                                 ////
+////                                                                   ////
+////  MFRC522_isCard() finds no card until call BENCH_CARD_AT, which   ////
+////  sees a Classic 1K with the uid of the first built-in user.       ////
+////  Anticollision and select are answered from that uid; everything  ////
+////  else fails, as with a card that left the field.                  ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef BENCH_CARD_AT
+   #define BENCH_CARD_AT   3        // isCard call that finds the card
+#endif
+
+#define MI_OK              0
+#define MI_ERR             2
+#define PICC_AUTHENT1A     0x60
+
+char const BENCH_UID[4] = {0xD3, 0x4D, 0xFC, 0x27};   // DATA_TRUNG
+
+BYTE bench_polls = 0;
+BYTE bench_tx[8], bench_ntx;        // frame loaded into the FIFO
+BYTE bench_rx[8], bench_nrx, bench_at;
+BYTE bench_irq;
+
+void MFRC522_Init(void)
+{
+}
+
+void MFRC522_Halt(void)
+{
+}
+
+int1 MFRC522_isCard(char *TagType)
+{
+   if(bench_polls < BENCH_CARD_AT)
+      ++bench_polls;
+   if(bench_polls != BENCH_CARD_AT)
+      return(FALSE);
+   ++bench_polls;                   // one tap only
+   TagType[0] = 0x04;
+   TagType[1] = 0x00;
+   return(TRUE);
+}
+
+BYTE MFRC522_Auth(BYTE mode, BYTE block, char *key, char *uid)
+{
+   return(MI_ERR);
+}
+
+BYTE MFRC522_Read(BYTE block, char *out)
+{
+   return(MI_ERR);
+}
+
+// CRC_A of the first n answer bytes, appended
+void bench_crc(BYTE n)
+{
+   int16 crc = 0x6363;
+   BYTE i, b;
+
+   for(i=0;i<n;++i)
+   {
+      b = bench_rx[i] ^ make8(crc,0);
+      b ^= b << 4;
+      crc = (crc >> 8) ^ ((int16)b << 8) ^ ((int16)b << 3) ^ (b >> 4);
+   }
+   bench_rx[n] = make8(crc,0);
+   bench_rx[n+1] = make8(crc,1);
+}
+
+// StartSend: answer the frame in the FIFO
+void bench_send(void)
+{
+   BYTE i;
+
+   bench_nrx = 0;
+   bench_at = 0;
+   bench_irq = 0x01;                // timer: no answer
+   if(bench_ntx < 2 || bench_tx[0] != 0x93)
+      return;
+   if(bench_tx[1] == 0x20)          // anticollision: uid and BCC
+   {
+      for(i=0;i<4;++i)
+         bench_rx[i] = BENCH_UID[i];
+      bench_rx[4] = BENCH_UID[0]^BENCH_UID[1]^BENCH_UID[2]^BENCH_UID[3];
+      bench_nrx = 5;
+   }
+   else if(bench_tx[1] == 0x70)     // select: SAK 08, Classic 1K
+   {
+      bench_rx[0] = 0x08;
+      bench_crc(1);
+      bench_nrx = 3;
+   }
+   else
+      return;
+   bench_irq = 0x30;                // RxIRq, IdleIRq
+}
+
+void MFRC522_Wr(BYTE reg, BYTE v)
+{
+   switch(reg)
+   {
+      case 0x09:                    // FIFODataReg
+         if(bench_ntx < 8)
+            bench_tx[bench_ntx++] = v;
+         break;
+      case 0x0A:                    // FIFOLevelReg: flush
+         bench_ntx = 0;
+         bench_nrx = bench_at = 0;
+         break;
+      case 0x04:                    // ComIrqReg: clear
+         bench_irq = 0;
+         break;
+      case 0x0D:                    // BitFramingReg: StartSend
+         if(v & 0x80)
+            bench_send();
+         break;
+   }
+}
+
+BYTE MFRC522_Rd(BYTE reg)
+{
+   switch(reg)
+   {
+      case 0x04:
+         return(bench_irq);
+      case 0x0A:
+         return(bench_nrx - bench_at);
+      case 0x09:
+         return(bench_at < bench_nrx ? bench_rx[bench_at++] : 0);
+   }
+   return(0);
+}
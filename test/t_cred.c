@@ -0,0 +1,78 @@
+// cred.c on the host flash model, 16 word rows as on the 16F887.  A
+// sync that runs out of slots must leave the live bank and the bank
+// switch as they were, with none of its changes visible.
+
+#include "host.h"
+
+#define CRED_ROW     16
+#define CRED_STAGE   7
+#include <overlay.c>
+#include <cred.c>
+
+// uids that all hash to home row h
+void uid_for(char uid[], BYTE h, BYTE i)
+{
+   uid[0] = i;
+   uid[1] = i;
+   uid[2] = 0x5A;
+   uid[3] = 0x5A ^ h;
+}
+
+int main(void)
+{
+   char uid[4];
+   BYTE i, k, user, bank;
+   int16 chain = (CRED_PROBE + 1) * CRED_SLOTS;
+
+   host_reset();
+   cred_init();
+
+   // fill every slot of one probe chain
+   for(i=0;i<chain;)
+   {
+      for(k=0;k<CRED_STAGE && i<chain;++k, ++i)
+      {
+         uid_for(uid, 5, i);
+         CHECK(cred_stage_add(uid, i & 0x3F));
+      }
+      CHECK(cred_sync());
+   }
+   for(i=0;i<chain;++i)
+   {
+      uid_for(uid, 5, i);
+      CHECK(cred_find(uid, &user) && user == (i & 0x3F));
+   }
+
+   // one more for the full chain, with an update and an add before it
+   bank = read_eeprom(CRED_EE_BANK);
+   uid_for(uid, 5, 1);
+   cred_stage_add(uid, 40);
+   uid_for(uid, 6, 0);                  // another home, has room
+   cred_stage_add(uid, 41);
+   uid_for(uid, 5, 200);
+   cred_stage_add(uid, 42);
+   CHECK(!cred_sync());
+   CHECK(cred_staged == 0);
+   CHECK(read_eeprom(CRED_EE_BANK) == bank && cred_live == bank);
+   CHECK(cred_bank_ok(cred_live));
+   uid_for(uid, 5, 1);
+   CHECK(cred_find(uid, &user) && user == 1);
+   uid_for(uid, 6, 0);
+   CHECK(!cred_find(uid, &user));
+   uid_for(uid, 5, 200);
+   CHECK(!cred_find(uid, &user));
+
+   // the next sync levels the idle bank again and goes through
+   uid_for(uid, 5, 1);
+   cred_stage_add(uid, 40);
+   CHECK(cred_sync());
+   CHECK(read_eeprom(CRED_EE_BANK) == (bank ^ 1));
+   CHECK(cred_find(uid, &user) && user == 40);
+   uid_for(uid, 5, 2);
+   CHECK(cred_find(uid, &user) && user == 2);
+   uid_for(uid, 6, 0);                  // left in the idle bank, levelled out
+   CHECK(!cred_find(uid, &user));
+   cred_init();
+   CHECK(cred_live == (bank ^ 1));
+   return(host_failed != 0);
+}
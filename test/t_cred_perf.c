@@ -0,0 +1,140 @@
+// cred.c capacity and timing on the host flash model, with the CCS
+// defaults for the 16F887: 0x1800-0x1FFF, 16 word rows, 8 probe rows.
+// Badges with pseudo-random uids are enrolled until the store refuses
+// them.  At that fill every badge is looked up with the row cache cold,
+// as a tap after another badge would find it, and so are uids that are
+// not enrolled.  Then a sync of one stage of updates is timed, and a full
+// bank update: a sync whose idle bank has to be rewritten row by row.
+//
+// The figures are host_cycles: flash reads at the EECON sequence cost,
+// writes at the datasheet 2 ms per 8 word block and 4 ms per EEPROM
+// byte.  The compare loop around the reads is not counted.
+
+#include "host.h"
+
+#define CRED_ROW     16
+#define CRED_STAGE   7
+#include <overlay.c>
+#include <cred.c>
+
+#define TRIES        2000
+
+uint32_t seed = 1;
+char uids[TRIES][4];
+int32 writes;
+
+void nv(void)
+{
+   ++writes;
+}
+
+void uid_next(char uid[])
+{
+   BYTE i;
+
+   for(i=0;i<4;++i)
+   {
+      seed = seed * 1103515245 + 12345;
+      uid[i] = seed >> 16;
+   }
+}
+
+double us(uint64_t c)
+{
+   return(c / (double)HOST_MHZ);
+}
+
+// Look up n uids cold; returns the longest, adds the total to *sum
+uint64_t lookups(int n, int1 enrolled, uint64_t *sum)
+{
+   uint64_t t, worst = 0;
+   char uid[4];
+   BYTE user;
+   int i;
+
+   *sum = 0;
+   for(i=0;i<n;++i)
+   {
+      if(enrolled)
+         memcpy(uid, uids[i], 4);
+      else
+         uid_next(uid);
+      cred_valid = 0;
+      t = host_cycles;
+      CHECK(cred_find(uid, &user) == enrolled);
+      t = host_cycles - t;
+      *sum += t;
+      if(t > worst)
+         worst = t;
+   }
+   return(worst);
+}
+
+int main(void)
+{
+   int n = 0, k, refused = 0;
+   uint64_t t, worst, sum;
+
+   host_reset();
+   cred_init();
+
+   // one stage at a time until a stage is refused, then one at a time
+   while(n < TRIES && refused < 8)
+   {
+      for(k=0;k<(refused ? 1 : CRED_STAGE);++k)
+      {
+         uid_next(uids[n + k]);
+         cred_stage_add(uids[n + k], (n + k) & 0x3F);
+      }
+      if(cred_sync())
+         n += k;
+      else
+         ++refused;
+   }
+   printf("capacity: %d badges of %d slots per bank (%d%%)\n", n,
+          CRED_ROWS * CRED_SLOTS, n * 100 / (CRED_ROWS * CRED_SLOTS));
+   CHECK(n > CRED_ROWS * CRED_SLOTS * 3 / 4);
+
+   worst = lookups(n, TRUE, &sum);
+   printf("lookup, enrolled:     %5.0f us average, %5.0f us worst\n",
+          us(sum) / n, us(worst));
+   CHECK(us(worst) <= us((CRED_PROBE + 1) *
+                         (uint64_t)CRED_ROW * (HOST_FLASH_READ + 4)));
+   worst = lookups(1000, FALSE, &sum);
+   printf("lookup, not enrolled: %5.0f us average, %5.0f us worst\n",
+          us(sum) / 1000, us(worst));
+
+   // a stage of user changes, rows already level
+   for(k=0;k<CRED_STAGE;++k)
+      cred_stage_add(uids[k * 37], 63 - k);
+   cred_sync();                         // levels the rows last changed
+   for(k=0;k<CRED_STAGE;++k)
+      cred_stage_add(uids[k * 37], k);
+   host_nv = nv;
+   writes = 0;
+   t = host_cycles;
+   CHECK(cred_sync());
+   t = host_cycles - t;
+   printf("sync of %d updates:   %5.0f ms, %ld flash words and EEPROM "
+          "bytes written\n", CRED_STAGE, us(t) / 1000, (long)writes);
+
+   // the idle bank lost: every row is written again
+   for(k=0;k<CRED_BANK;++k)
+      host_flash[CRED_BASE + (cred_live ^ 1) * CRED_BANK + k] = 0x3FFF;
+   cred_stage_add(uids[1], 1);
+   writes = 0;
+   t = host_cycles;
+   CHECK(cred_sync());
+   t = host_cycles - t;
+   host_nv = NULL;
+   printf("full bank update:     %5.0f ms, %ld flash words and EEPROM "
+          "bytes written\n", us(t) / 1000, (long)writes);
+   CHECK(writes >= CRED_BANK);
+   for(k=0;k<n;++k)
+   {
+      BYTE user;
+
+      CHECK(cred_find(uids[k], &user));
+   }
+   return(host_failed != 0);
+}
@@ -0,0 +1,241 @@
+// Power cuts through cred_sync().  The sync is run once to count its
+// EEPROM and flash word writes, then again with the power cut before
+// write 1, 2, ... n.  After each cut the RAM state is dropped and
+// cred_init() runs as on power-up: every badge must then read as before
+// the sync or as after it, never a mix, and a new sync must go through.
+// The bank switch is the last write, so every clean cut should leave the
+// old badges.  The cuts are then made again with the write they land on
+// torn: the byte or word left with some bits programmed and some not.
+// A torn switch byte may select either bank, but never a mix of them.
+
+#include "host.h"
+#include <setjmp.h>
+
+#define CRED_ROW     16
+#define CRED_STAGE   7
+#include <overlay.c>
+#include <cred.c>
+
+#define BADGES       24
+
+jmp_buf cut;
+int32 writes, cut_at;
+int1 tear;
+BYTE torn = 0x5A;
+
+void nv(void)
+{
+   if(++writes != cut_at)
+      return;
+   if(tear)
+   {
+      torn = torn * 13 + 7;
+      if(host_nv_ee)
+         *host_nv_ee ^= torn;
+      else
+         *host_nv_flash = (*host_nv_flash ^ make16(torn, ~torn)) & 0x3FFF;
+   }
+   longjmp(cut, 1);
+}
+
+void uid_of(char uid[], BYTE i)
+{
+   uid[0] = i * 37;
+   uid[1] = i;
+   uid[2] = 0xA0 + (i & 3);         // several badges per home row
+   uid[3] = 0x11;
+}
+
+// Badges 0-15 enrolled as user i
+void before(void)
+{
+   char uid[4];
+   BYTE i;
+
+   host_reset();
+   cred_valid = cred_dirty = 0;
+   cred_staged = 0;
+   cred_init();
+   for(i=0;i<16;++i)
+   {
+      uid_of(uid, i);
+      cred_stage_add(uid, i);
+      if(cred_staged == CRED_STAGE)
+         cred_sync();
+   }
+   cred_sync();
+}
+
+// The sync under test: remove 0-2, move 3-5 to user 50+i, add 16
+void stage(void)
+{
+   char uid[4];
+   BYTE i;
+
+   for(i=0;i<3;++i)
+   {
+      uid_of(uid, i);
+      cred_stage_del(uid);
+   }
+   for(i=3;i<6;++i)
+   {
+      uid_of(uid, i);
+      cred_stage_add(uid, 50 + i);
+   }
+   uid_of(uid, 16);
+   cred_stage_add(uid, 16);
+}
+
+// 0 = as before the sync, 1 = as after, 2 = a mix
+int state(void)
+{
+   char uid[4];
+   BYTE i, user;
+   int old = 1, now = 1, has;
+
+   for(i=0;i<BADGES;++i)
+   {
+      uid_of(uid, i);
+      has = cred_find(uid, &user);
+      if(i < 3)
+      {
+         old &= has && user == i;
+         now &= !has;
+      }
+      else if(i < 6)
+      {
+         old &= has && user == i;
+         now &= has && user == 50 + i;
+      }
+      else if(i < 16)
+      {
+         old &= has && user == i;
+         now &= has && user == i;
+      }
+      else if(i == 16)
+      {
+         old &= !has;
+         now &= has && user == 16;
+      }
+      else
+      {
+         old &= !has;
+         now &= !has;
+      }
+   }
+   return(now ? 1 : old ? 0 : 2);
+}
+
+// After a restart: the stage went in whole or not at all
+int all_or_none(void)
+{
+   char uid[4];
+   BYTE i, user, has = 0;
+
+   cred_valid = cred_dirty = 0;
+   cred_staged = 0;
+   cred_init();
+   for(i=0;i<CRED_STAGE;++i)
+   {
+      uid_of(uid, i);
+      has += cred_find(uid, &user) && user == i;
+   }
+   return(has == 0 || has == CRED_STAGE);
+}
+
+// The first sync on a new device, with CRED_EE_BANK still erased
+int first_sync(int32 n)
+{
+   char uid[4];
+   BYTE i;
+
+   host_reset();
+   cred_valid = cred_dirty = 0;
+   cred_staged = 0;
+   cred_init();
+   for(i=0;i<CRED_STAGE;++i)
+   {
+      uid_of(uid, i);
+      cred_stage_add(uid, i);
+   }
+   host_nv = nv;
+   writes = 0;
+   cut_at = n;
+   if(!setjmp(cut))
+      cred_sync();
+   host_nv = NULL;
+   return(all_or_none());
+}
+
+// Every cut in turn; got[] counts the states they left
+int32 cuts(int32 got[3])
+{
+   int32 total, n;
+   char uid[4];
+   BYTE user;
+
+   before();
+   stage();
+   host_nv = nv;
+   writes = 0;
+   cut_at = 0;
+   CHECK(cred_sync());
+   total = writes;
+   CHECK(state() == 1);
+
+   for(n=1;n<=total;++n)
+   {
+      before();
+      stage();
+      host_nv = nv;
+      writes = 0;
+      cut_at = n;
+      if(!setjmp(cut))
+      {
+         cred_sync();
+         CHECK(0);                      // the cut never came
+      }
+      host_nv = NULL;
+
+      // power-up: RAM is gone, flash and EEPROM stay
+      cred_valid = cred_dirty = 0;
+      cred_staged = 0;
+      cred_live = 0;
+      cred_init();
+      ++got[state()];
+      if(state() == 2)
+         printf("cut before write %ld of %ld: badges mixed\n", (long)n,
+                (long)total);
+
+      uid_of(uid, 20);
+      cred_stage_add(uid, 20);
+      CHECK(cred_sync());
+      CHECK(cred_find(uid, &user) && user == 20);
+      cred_valid = 0;
+      cred_init();
+      CHECK(cred_find(uid, &user) && user == 20);
+   }
+   printf("%ld writes per sync, %s: %ld cuts left the old badges, %ld the "
+          "new, %ld a mix\n", (long)total, tear ? "torn" : "clean",
+          (long)got[0], (long)got[1], (long)got[2]);
+   return(total);
+}
+
+int main(void)
+{
+   int32 total, n, got[3] = {0, 0, 0}, torn_got[3] = {0, 0, 0};
+
+   total = cuts(got);
+   CHECK(got[2] == 0);
+   CHECK(got[0] == total);             // the switch is the last write
+   tear = 1;
+   cuts(torn_got);
+   CHECK(torn_got[2] == 0);
+
+   tear = 0;
+   CHECK(first_sync(0));
+   total = writes;
+   for(n=1;n<=total;++n)
+      CHECK(first_sync(n));
+   return(host_failed != 0);
+}
@@ -0,0 +1,47 @@
+// door.c on the default door table: door 0 toggles, door 1 holds 5 s.
+// An erased mask and the built-in users open the main door only, a
+// stored mask loses the bits of doors not fitted, and door_shut tells a
+// grant that locked the toggling door from one that opened it.
+
+#include "host.h"
+#include <door.c>
+
+int main(void)
+{
+   int16 ms;
+
+   host_reset();
+   door_init();
+   CHECK((PORTC & 0x12) == 0 && (TRISC & 0x12) == 0);
+
+   // erased EEPROM: a door added to the table stays out of the mask
+   CHECK(door_mask(0) == DOOR_DEFAULT);
+   CHECK(door_mask(0) == 0x01);
+   host_ee[DOOR_EE_MASK+1] = 0x03;
+   host_ee[DOOR_EE_MASK+2] = 0x86;
+   CHECK(door_mask(1) == 0x03);
+   CHECK(door_mask(2) == 0x02);
+   CHECK(door_mask(DOOR_USERS) == DOOR_DEFAULT);
+   CHECK(door_mask(0xFF) == DOOR_DEFAULT);
+
+   // toggling main door: open, then shut, then open again
+   CHECK(door_grant(door_mask(0)) == 0x01 && !door_shut);
+   CHECK(PORTC == 0x02);
+   CHECK(door_grant(door_mask(0)) == 0 && door_shut == 0x01);
+   CHECK(PORTC == 0);
+   CHECK(door_grant(door_mask(0)) == 0x01 && !door_shut);
+
+   // both doors: the main door shuts, the inner door opens for 5 s
+   CHECK(door_grant(door_mask(1)) == 0x02 && door_shut == 0x01);
+   CHECK(PORTC == 0x10);
+   for(ms=1;ms<5000;++ms)
+      door_isr();
+   CHECK(PORTC == 0x10);
+   door_isr();
+   CHECK(PORTC == 0 && door_out == 0);
+
+   // a held door is never reported shut
+   CHECK(door_grant(door_mask(2)) == 0x02 && !door_shut);
+   CHECK(door_grant(door_mask(2)) == 0x02 && !door_shut);
+   return(host_failed != 0);
+}
@@ -0,0 +1,219 @@
+// Airlock schedules on the 1 ms tick.  People arrive at the outer door,
+// badge for both doors, open each door once its strike releases, walk
+// through and let it close behind them.  Arrivals, reaction and walking
+// times come from a fixed pseudo-random sequence; some schedules have
+// people holding a door open or never turning up at the door at all.
+//
+// Under no schedule may both contacts read open, or both strikes be
+// released, in the same millisecond.  Everyone must get through; the
+// average time from badge to inner door shut is printed per schedule.
+//
+// Then the queue on its own: requests made at once each get an airlock
+// cycle of their own, up to IL_QUEUE, and a request whose door cannot
+// open is dropped after IL_WAIT_MS at the head of the line.
+
+#include "host.h"
+
+#define DOOR_HOLDS   {5000, 5000}
+#include <door.c>
+#include <interlock.c>
+
+#define PEOPLE      40
+
+typedef struct
+{
+   int32 arrive;                    // ms the badge is shown
+   int32 react;                     // ms from release to pulling the door
+   int32 walk[2];                   // ms each door stays open
+   int32_t at;                      // ms the current step started, or
+                                    // -1 until the strike releases
+   BYTE step;                       // 0 outer, 1 through outer, 2 inner,
+                                    // 3 through inner, 4 done, 5 walked off
+} PERSON;
+
+PERSON p[PEOPLE];
+BYTE open_door[2];                  // contact reads open
+uint32_t seed;
+
+int32 rnd(int32 lo, int32 hi)
+{
+   seed = seed * 1103515245 + 12345;
+   return(lo + (int32)((seed >> 8) % (uint32_t)(hi - lo + 1)));
+}
+
+void contacts(void)
+{
+   PORTB = (PORTB & ~((1 << IL_SENSE_0) | (1 << IL_SENSE_1)))
+         | (open_door[0] << IL_SENSE_0) | (open_door[1] << IL_SENSE_1);
+}
+
+int1 released(BYTE d)
+{
+   return((door_out & DOOR_BIT[d]) != 0);
+}
+
+void run(const char *name, int32 every, int32 spread, int32 held, int n,
+         int walk_off)
+{
+   int32 now, sum = 0, worst = 0;
+   int i, both_open = 0, both_released = 0, served = 0, again = 0, gone = 0;
+   int user[2];                     // who has each door open, -1 none
+
+   host_reset();
+   door_init();
+   il_init();
+   il_want[0] = il_want[1] = 0;
+   il_served = 0;
+   open_door[0] = open_door[1] = 0;
+   user[0] = user[1] = -1;
+   contacts();
+   seed = 1;
+   for(i=0;i<n;++i)
+   {
+      p[i].arrive = i * every + rnd(0, spread);
+      p[i].react = rnd(300, 1500);
+      p[i].walk[0] = rnd(1500, 4000);
+      p[i].walk[1] = rnd(1500, 4000);
+      if(held && i % 5 == 2)
+         p[i].walk[rnd(0, 1)] = held;
+      p[i].step = 0;
+      if(walk_off && i % 7 == 3)
+      {
+         p[i].step = 5;
+         ++gone;
+      }
+      p[i].at = -1;
+   }
+
+   for(now=0;now<3600000 && served + gone < n;++now)
+   {
+      for(i=0;i<n;++i)
+      {
+         PERSON *q = &p[i];
+         BYTE d = q->step >> 1;
+
+         if(now == q->arrive)
+            il_request(3);
+         if(now < q->arrive || q->step >= 4)
+            continue;
+         if(q->step & 1)                    // walking through door d
+         {
+            if(now - q->at < q->walk[d])
+               continue;
+            open_door[d] = 0;
+            user[d] = -1;
+            if(++q->step == 4)
+            {
+               sum += now - q->arrive;
+               if(now - q->arrive > worst)
+                  worst = now - q->arrive;
+               ++served;
+            }
+            else
+               q->at = -1;
+            continue;
+         }
+         // at door d: first in line pulls it once the strike is released
+         if(user[d] >= 0 || open_door[d])
+            continue;
+         if(d == 0 && (i && p[i-1].step < 2 && p[i-1].step != 5 &&
+                       p[i-1].arrive <= now))
+            continue;
+         if(!released(d))
+         {
+            q->at = -1;
+            if(!il_want[d])                 // request dropped: badge again
+            {
+               il_request(1 << d);
+               ++again;
+            }
+            continue;
+         }
+         if(q->at < 0)
+            q->at = now;
+         if(now - q->at < q->react)
+            continue;
+         open_door[d] = 1;
+         user[d] = i;
+         q->at = now;
+         ++q->step;
+      }
+      contacts();
+      door_isr();
+      il_isr();
+      if(open_door[0] && open_door[1])
+         ++both_open;
+      if(released(0) && released(1))
+         ++both_released;
+   }
+
+   printf("%-28s %2d through, %2d badged again, cycle %5.1f s avg %5.1f s "
+          "worst\n", name, served, again, served ? sum / 1000.0 / served : 0,
+          worst / 1000.0);
+   CHECK(both_open == 0);
+   CHECK(both_released == 0);
+   CHECK(served + gone == n);
+}
+
+// Strike releases per door over ms ticks, the contacts shut throughout
+// unless inner_open
+void cycles(int32 ms, int1 inner_open, int opens[2])
+{
+   BYTE was = 0;
+
+   open_door[0] = 0;
+   open_door[1] = inner_open;
+   contacts();
+   while(ms--)
+   {
+      door_isr();
+      il_isr();
+      if((door_out & DOOR_BIT[0]) && !(was & DOOR_BIT[0]))
+         ++opens[0];
+      if((door_out & DOOR_BIT[1]) && !(was & DOOR_BIT[1]))
+         ++opens[1];
+      CHECK(!(released(0) && released(1)));
+      was = door_out;
+   }
+}
+
+void queue(void)
+{
+   int opens[2] = {0, 0}, n;
+
+   host_reset();
+   door_init();
+   il_init();
+   il_want[0] = il_want[1] = 0;
+   il_served = 0;
+   for(n=0;n<IL_QUEUE;++n)
+      CHECK(il_request(3));
+   CHECK(!il_request(1));               // full: nothing queued
+   CHECK(il_want[0] == IL_QUEUE && il_want[1] == IL_QUEUE);
+   cycles(IL_QUEUE * 2 * 6000L, 0, opens);
+   CHECK(opens[0] == IL_QUEUE && opens[1] == IL_QUEUE);
+   CHECK(il_served == 2 * IL_QUEUE && !il_want[0] && !il_want[1]);
+   printf("%d requests at once: %d outer and %d inner releases\n",
+          IL_QUEUE, opens[0], opens[1]);
+
+   // inner door propped open: the outer requests time out one by one
+   opens[0] = opens[1] = 0;
+   CHECK(il_request(1) && il_request(1));
+   cycles(IL_WAIT_MS, 1, opens);
+   CHECK(il_want[0] == 1);
+   cycles(IL_WAIT_MS, 1, opens);
+   CHECK(il_want[0] == 0 && opens[0] == 0);
+}
+
+int main(void)
+{
+   run("one person at a time", 60000, 0, 0, 10, 0);
+   run("one every 20 s", 20000, 5000, 0, PEOPLE, 0);
+   run("one every 10 s", 10000, 5000, 0, PEOPLE, 0);
+   run("queue of 20", 0, 2000, 0, 20, 0);
+   run("door held open 20 s", 10000, 5000, 20000, PEOPLE, 0);
+   run("door held open 45 s", 15000, 5000, 45000, PEOPLE, 0);
+   run("badge and walk off", 10000, 5000, 0, PEOPLE, 1);
+   queue();
+   return(host_failed != 0);
+}
@@ -0,0 +1,175 @@
+// isodep.c against a scripted card: the reader timer is back at the
+// MFRC522_Init() values after a failed PPS, and an S(WTX) stretches the
+// next frame wait by WTXM for that frame only.  A PPS sets the rates the
+// card offers, but no faster than 212 kbit/s towards the reader while
+// FSD is over the FIFO.  Long commands go out in chained I-blocks, each
+// acknowledged with the block number it carried, and chained answers are
+// put back together over the PCBs that land in the data.
+
+#include "host.h"
+
+#define RC_FAIL            0xFF
+
+BYTE rc_reg[64];                    // MFRC522 registers as last written
+const char *card[8];                // answers, first byte is the length
+BYTE card_n, card_at;
+int16 reload[8];                    // TReload in force for each answer
+char sent[8][32];                   // frames the reader sent
+
+void MFRC522_Wr(BYTE a, BYTE v)
+{
+   rc_reg[a & 0x3F] = v;
+}
+
+void rc522_open(void)
+{
+   sent[card_at][0] = 0;
+}
+
+void rc522_put(char *tx, BYTE len)
+{
+   BYTE i;
+
+   for(i=0;i<len && sent[card_at][0] < sizeof(sent[0]) - 1;++i)
+      sent[card_at][1 + sent[card_at][0]++] = tx[i];
+}
+
+void rc522_go(int1 crc)
+{
+   (void)crc;
+}
+
+void rc522_start(char *tx, BYTE len, int1 crc)
+{
+   (void)crc;
+   rc522_open();
+   rc522_put(tx, len);
+}
+
+BYTE rc522_finish(char *rx, BYTE max, int1 crc)
+{
+   BYTE n;
+
+   (void)crc;
+   reload[card_at] = make16(rc_reg[0x2C], rc_reg[0x2D]);
+   if(card_at >= card_n || !card[card_at])
+   {
+      ++card_at;
+      return(RC_FAIL);
+   }
+   n = card[card_at][0];
+   memcpy(rx, card[card_at] + 1, n < max ? n : max);
+   ++card_at;
+   return(n);
+}
+
+void script(const char *a, const char *b, const char *c, const char *d)
+{
+   card[0] = a;
+   card[1] = b;
+   card[2] = c;
+   card[3] = d;
+   card_n = 4;
+   card_at = 0;
+   memset(rc_reg, 0, sizeof(rc_reg));
+}
+
+int1 init_timer(void)
+{
+   return(rc_reg[0x2A] == 0x8D && rc_reg[0x2B] == 0x3E &&
+          rc_reg[0x2C] == 0 && rc_reg[0x2D] == 30 &&
+          rc_reg[0x12] == 0 && rc_reg[0x13] == 0);
+}
+
+#include <overlay.c>
+#include <isodep.c>
+
+int main(void)
+{
+   char buf[ISODEP_ATS_MAX];
+   char apdu[20] = {0x00, 0xB0, 0x00, 0x00, 0x02};
+   BYTE i;
+
+   // ATS: FSCI 5, TA1 848 both ways, TB1 FWI 8; no answer to the PPS
+   script("\x05\x05\x75\x77\x81\x00", NULL, NULL, NULL);
+   CHECK(!isodep_open(buf));
+   CHECK(card_at == 2);
+   CHECK(reload[1] == 129);              // FWI 8: 2^8/2 + 1
+   CHECK(init_timer());
+
+   // PPS refused with a wrong PPSS
+   script("\x05\x05\x75\x77\x81\x00", "\x01\xD1", NULL, NULL);
+   CHECK(!isodep_open(buf));
+   CHECK(init_timer());
+
+   // no PPS (TA1 absent), then a command answered after two WTX
+   script("\x03\x03\x21\x40", "\x02\xF2\x03", "\x02\xF2\x3F",
+          "\x05\x02\x12\x34\x90\x00");
+   CHECK(isodep_open(buf));
+   CHECK(iso->fwt == 9);                 // FWI 4
+   CHECK(make16(rc_reg[0x2C], rc_reg[0x2D]) == 9);
+   CHECK(isodep_apdu(apdu, 5, buf, ISODEP_ATS_MAX) == 4);
+   CHECK(reload[1] == 9);                // the I-block answer
+   CHECK(reload[2] == 27);               // after WTXM 3
+   CHECK(reload[3] == 9 * 63);           // after WTXM 63
+   CHECK(sent[2][1] == (char)0xF2 && sent[2][2] == 3);
+   CHECK(make16(rc_reg[0x2C], rc_reg[0x2D]) == 9);
+   CHECK(buf[1] == 0x12 && buf[2] == 0x34);
+
+   // WTXM * FWT is capped at FWT for FWI 14
+   script("\x03\x03\x21\xE0", "\x02\xF2\x3B", "\x02\x02\x90\x00", NULL);
+   CHECK(isodep_open(buf));
+   CHECK(iso->fwt == 8193);
+   card[2] = "\x03\x02\x90\x00";
+   CHECK(isodep_apdu(apdu, 5, buf, ISODEP_ATS_MAX) == 2);
+   CHECK(reload[2] == ISO_FWT_MAX);
+   CHECK(make16(rc_reg[0x2C], rc_reg[0x2D]) == 8193);
+
+   isodep_close();
+   CHECK(init_timer());
+
+   // PPS accepted: 848 kbit/s out, 212 back with FSD 128
+   script("\x05\x05\x75\x77\x81\x00", "\x01\xD0", NULL, NULL);
+   CHECK(isodep_open(buf));
+   CHECK(sent[1][0] == 3 && sent[1][1] == (char)0xD0 &&
+         sent[1][2] == 0x11 && sent[1][3] == ((1 << 2) | 3));
+   CHECK(rc_reg[0x12] == 3 << 4 && rc_reg[0x13] == 1 << 4);
+   CHECK(rc_reg[0x24] == ISO_MODWIDTH[3]);
+
+   // a 20 byte command at FSC 16: 13 bytes chained, R(ACK 0), the rest
+   for(i=0;i<20;++i)
+      apdu[i] = i;
+   script("\x02\x02\x00", "\x01\xA2", "\x03\x03\x90\x00", NULL);
+   CHECK(isodep_open(buf));
+   CHECK(iso->fsc == 13);
+   CHECK(isodep_apdu(apdu, 20, buf, ISODEP_ATS_MAX) == 2);
+   CHECK(sent[1][0] == 14 && sent[1][1] == 0x12);
+   CHECK(!memcmp(sent[1] + 2, apdu, 13));
+   CHECK(sent[2][0] == 8 && sent[2][1] == 0x03);
+   CHECK(!memcmp(sent[2] + 2, apdu + 13, 7));
+   CHECK(buf[1] == (char)0x90 && buf[2] == 0x00 && iso->bn == 0);
+
+   // the R(ACK) names the other block: the card lost the chain
+   script("\x02\x02\x00", "\x01\xA3", "\x03\x03\x90\x00", NULL);
+   CHECK(isodep_open(buf));
+   CHECK(isodep_apdu(apdu, 20, buf, ISODEP_ATS_MAX) == ISODEP_FAIL);
+   CHECK(card_at == 2);
+
+   // a chained answer: the second PCB lands on 0xCC and is put back
+   apdu[0] = 0x00;
+   script("\x02\x02\x00", "\x04\x12\xAA\xBB\xCC",
+          "\x04\x03\xDD\x90\x00", NULL);
+   CHECK(isodep_open(buf));
+   CHECK(isodep_apdu(apdu, 5, buf, ISODEP_ATS_MAX) == 6);
+   CHECK(sent[2][0] == 1 && sent[2][1] == (char)0xA3);
+   CHECK(!memcmp(buf + 1, "\xAA\xBB\xCC\xDD\x90\x00", 6));
+   CHECK(iso->bn == 0);
+
+   // an answer carrying the wrong block number
+   script("\x02\x02\x00", "\x04\x12\xAA\xBB\xCC",
+          "\x04\x02\xDD\x90\x00", NULL);
+   CHECK(isodep_open(buf));
+   CHECK(isodep_apdu(apdu, 5, buf, ISODEP_ATS_MAX) == ISODEP_FAIL);
+
+   return(host_failed != 0);
+}
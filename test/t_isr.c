@@ -0,0 +1,220 @@
+// Interrupt sources overlapping on one cycle-stepped model: Timer2 ticks
+// every 1 ms, Timer0 runs the Wiegand output, and the output is looped
+// back into the RB4/RB5 inputs so every pulse also raises RB while the
+// Timer0 handler is still running.  Handlers are dispatched one at a
+// time in the code1.c #priority order (rb, rtcc, timer2) with the CCS
+// context save and restore around them.
+//
+// No flag may be lost, the looped back frame must arrive whole, and the
+// isr_stat.c figures must match the delays the model produced, including
+// a Timer2 wait held past 255 cycles with interrupts off.
+
+#include "host.h"
+
+#define ISR_STATS
+
+// Stand-in handler bodies in cycles: the host only charges pin accesses,
+// so the rest of each handler is added when it reads Timer1 to leave
+#define CTX_SAVE    24
+#define CTX_RESTORE 16
+const int16 body[3] = {90, 40, 45};     // timer2, rtcc, rb
+
+BYTE flag, running = 0xFF;
+uint64_t flagged[3];
+int lost[3], ticks;
+int32 overlap;
+int16 t1_reads;
+
+int16 t1(void)
+{
+   if(running != 0xFF && (++t1_reads & 1) == 0)
+      host_cycles += body[running];
+   return((int16)host_cycles);
+}
+
+#undef get_timer1
+#undef set_timer0
+#undef clear_interrupt
+#define get_timer1()        t1()
+#define set_timer0(v)       (host_tmr0 = (v), pre0 = 0)
+#define clear_interrupt(i)  (flag &= (BYTE)~(i))
+
+BYTE pre0, pre2, post2;
+uint64_t now;                       // cycle the timers are at
+
+#include <isr_stat.c>
+#include <tick.c>
+#include <door.c>
+#include <wiegand.c>
+#include <wiegand_in.c>
+
+// code1.c's tick handler without the optional modules.  gcc widens
+// get_timer2()*4 by itself; CCS keeps 8 bits unless the count is cast.
+void NGAT_TIMER2(void)
+{
+   ISR_ENTER();
+   ISR_WAIT(ISR_TIMER2, (int16)get_timer2()*4);
+   tick_isr();
+   door_isr();
+   ISR_LEAVE(ISR_TIMER2);
+}
+
+// A flag set again before its handler ran is a lost interrupt; one set
+// while a handler runs or another flag waits is an overlap
+void raise(BYTE src, BYTE f, uint64_t t)
+{
+   if(!(host_ie & f))
+      return;
+   if(flag & f)
+      ++lost[src];
+   if(running != 0xFF || (flag & host_ie))
+      ++overlap;
+   flag |= f;
+   flagged[src] = t;
+}
+
+// Wiegand output lines wired to the capture inputs
+void loop(BYTE pin, BYTE v)
+{
+   BYTE bit = pin == WG_D0 ? WGI_D0_BIT : WGI_D1_BIT;
+
+   if(pin != WG_D0 && pin != WG_D1)
+      return;
+   if(v)
+      PORTB |= 1 << bit;
+   else
+      PORTB &= ~(1 << bit);
+   raise(ISR_RB, INT_RB, host_cycles);
+}
+
+// Bring the timers up to host_cycles
+
+void sync(void)
+{
+   for(; now < host_cycles; ++now)
+   {
+      if(++pre0 == 8)
+      {
+         pre0 = 0;
+         if(!++host_tmr0)
+            raise(ISR_RTCC, INT_RTCC, now);
+      }
+      if(++pre2 == 4)
+      {
+         pre2 = 0;
+         if(++host_tmr2 == 250)
+         {
+            host_tmr2 = 0;
+            if(++post2 == 5)
+            {
+               post2 = 0;
+               raise(ISR_TIMER2, INT_TIMER2, now);
+               ++ticks;
+            }
+         }
+      }
+   }
+}
+
+// One pass of the CCS dispatcher, if anything is due
+int32 wait_cycles[3];
+
+void dispatch(void)
+{
+   BYTE due = flag & host_ie, src;
+   int32 w;
+
+   if(!(host_ie & GLOBAL) || !due)
+      return;
+   host_cycles += CTX_SAVE;
+   sync();
+   if(due & INT_RB)
+      src = ISR_RB;
+   else if(due & INT_RTCC)
+      src = ISR_RTCC;
+   else
+      src = ISR_TIMER2;
+   w = host_cycles - flagged[src];
+   if(src != ISR_RB && w > wait_cycles[src])
+      wait_cycles[src] = w;
+   flag &= ~(src == ISR_RB ? INT_RB : src == ISR_RTCC ? INT_RTCC : INT_TIMER2);
+   running = src;
+   t1_reads = 0;
+   if(src == ISR_RB)
+      wgi_isr();
+   else if(src == ISR_RTCC)
+      wg_isr();
+   else
+      NGAT_TIMER2();
+   running = 0xFF;
+   host_cycles += CTX_RESTORE;
+   sync();
+}
+
+void run(uint64_t until, uint64_t off_at, uint64_t off_for)
+{
+   while(host_cycles < until)
+   {
+      if(off_for && host_cycles >= off_at && host_cycles < off_at + off_for)
+         host_ie &= ~GLOBAL;
+      else
+         host_ie |= GLOBAL;
+      dispatch();
+      ++host_cycles;                  // main loop
+      sync();
+   }
+}
+
+void show(const char *name, BYTE src)
+{
+   printf("%-7s %5u runs, longest %5.1f us", name, isr_count[src],
+          isr_time[src] / 5.0);
+   if(src != ISR_RB)                   // no count of its own to read
+      printf(", waited up to %5.1f us", isr_wait[src] / 5.0);
+   printf("\n");
+}
+
+int main(void)
+{
+   char id[4] = {0xD3, 0x5A, 0x3C, 0x96}, uid[4];
+
+   host_reset();
+   host_edge = loop;
+   now = 0;
+   wg_init();
+   wgi_init();
+   tick_init();
+   door_init();
+   host_ie |= GLOBAL;
+
+   // a uid sent out and read back keeps its bytes where they were
+   CHECK(wg_send(id, 26));
+   run(5000L * 70, 0, 0);             // frame out, then the 20 ms gap
+   CHECK(wgi_frame(uid));
+   CHECK(!memcmp(uid, id, 3) && uid[3] == 0);
+   CHECK(wgi_n == 0 && !wg_left);
+
+   CHECK(wg_send(id, 34));
+   run(5000L * 160, 0, 0);
+   CHECK(wgi_frame(uid));
+   CHECK(!memcmp(uid, id, 4));
+
+   // interrupts off for 100 us around a tick: the wait passes 255 cycles
+   run(5000L * 162, 5000L * 160 + 4900, 500);
+
+   CHECK(lost[0] == 0 && lost[1] == 0 && lost[2] == 0);
+   CHECK(tick_ms == ticks - !!(flag & INT_TIMER2));
+   CHECK(isr_count[ISR_TIMER2] == tick_ms);
+   CHECK(isr_count[ISR_RB] == 2 * (26 + 34));
+   CHECK(overlap > 0);
+   CHECK(isr_wait[ISR_TIMER2] == wait_cycles[ISR_TIMER2] / 4 * 4);
+   CHECK(isr_wait[ISR_TIMER2] > 255);
+   CHECK(isr_wait[ISR_RTCC] == wait_cycles[ISR_RTCC] / 8 * 8);
+
+   printf("%ld ms, %ld interrupts raised over another\n",
+          (long)(host_cycles / 5000), (long)overlap);
+   show("timer2", ISR_TIMER2);
+   show("rtcc", ISR_RTCC);
+   show("rb", ISR_RB);
+   return(host_failed != 0);
+}
@@ -0,0 +1,15 @@
+#!/bin/sh
+# ladecode.py against the captures in capture/: each NAME.csv must give
+# NAME.out.  decide.csv is also read with its columns given by number.
+# The captures are synthetic, made by capture/gen.py; a capture from the
+# bench can be added the same way with the report it should give.
+
+fail=0
+for c in capture/*.csv; do
+   python3 ../ladecode.py "$c" > "$OUT/$(basename "$c" .csv).out" || fail=1
+   diff -u "${c%.csv}.out" "$OUT/$(basename "$c" .csv).out" || fail=1
+done
+python3 ../ladecode.py capture/decide.csv --ch mark=0 --ch en=1 \
+   > "$OUT/bynumber.out" || fail=1
+diff -u capture/bynumber.out "$OUT/bynumber.out" || fail=1
+exit $fail
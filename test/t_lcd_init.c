@@ -0,0 +1,64 @@
+// lcd_init() on the HD44780 model: how long it takes, and that a missing
+// display or a stuck busy flag is found in bounded time and the screen
+// still comes out right.
+
+#include "host.h"
+#include "hd44780.c"
+#include <lcd.c>
+
+double ms(uint64_t c)
+{
+   return(c / (HOST_MHZ * 1000.0));
+}
+
+void puts_lcd(const char *s)
+{
+   while(*s)
+      lcd_putc(*s++);
+}
+
+int main(void)
+{
+   uint64_t t;
+   int1 ok;
+
+   host_reset();
+   hd_reset();
+   ok = lcd_init();
+   t = host_cycles;
+   printf("lcd_init, display present:    %6.2f ms\n", ms(t));
+   CHECK(ok);
+   CHECK(hd_four && hd_display == 0x0C && hd_ac == 0);
+   CHECK(hd_lost == 0 && hd_violations == 0);
+   CHECK(ms(t) < 25);
+   puts_lcd("\fXin moi quet the\nThe hop le");
+   CHECK(!strcmp(hd_line(1), "Xin moi quet the"));
+   CHECK(!strncmp(hd_line(2), "The hop le", 10));
+   CHECK(hd_lost == 0);
+
+   host_reset();
+   hd_reset();
+   hd_dead = 1;
+   ok = lcd_init();
+   t = host_cycles;
+   printf("lcd_init, no display:         %6.2f ms\n", ms(t));
+   CHECK(!ok && lcd_fault);
+   CHECK(ms(t) < 100);
+   t = host_cycles;
+   puts_lcd("\fXin moi quet the");
+   printf("16 characters, no display:    %6.2f ms\n", ms(host_cycles - t));
+   CHECK(ms(host_cycles - t) < 10);
+
+   host_reset();
+   hd_reset();
+   hd_stuck_bf = 1;
+   ok = lcd_init();
+   printf("lcd_init, busy flag stuck:    %6.2f ms\n", ms(host_cycles));
+   CHECK(!ok && lcd_fault);
+   puts_lcd("\fXin moi quet the\nThe hop le");
+   CHECK(!strcmp(hd_line(1), "Xin moi quet the"));
+   CHECK(!strncmp(hd_line(2), "The hop le", 10));
+   CHECK(hd_lost == 0);
+
+   return(host_failed != 0);
+}
@@ -0,0 +1,139 @@
+// lcd_scrub() on the HD44780 model, one call per 1 ms tick as code1.c
+// makes it.  An idle screen must cost no writes.  Cells changed behind
+// the driver's back are put right, and so is an ESD hit (hd_glitch()).
+// Application writes between the checks land where they should, and the
+// check after a write sets the counter before it trusts it.  A display
+// that stops answering is retried with a doubling wait, and comes back
+// once it answers again.  A step that does not redraw is one bus transfer
+// and must stay within 8 us; the average and longest are printed.
+
+#include "host.h"
+#include "hd44780.c"
+#define LCD_SCRUB
+#include <lcd.c>
+
+int redraws;
+uint64_t spent, step_sum, step_max;
+int32 steps;
+
+void puts_lcd(const char *s)
+{
+   while(*s)
+      lcd_putc(*s++);
+}
+
+// n ticks; a call that takes longer than 10 ms ran lcd_init()
+void ticks(int32 n)
+{
+   uint64_t t;
+
+   while(n--)
+   {
+      t = host_cycles;
+      lcd_scrub();
+      if(host_cycles - t > 10000L * HOST_MHZ)
+         ++redraws;
+      else if(!lcd_fault)
+      {
+         step_sum += host_cycles - t;
+         if(host_cycles - t > step_max)
+            step_max = host_cycles - t;
+         ++steps;
+      }
+      spent += host_cycles - t;
+      host_cycles = t + 1000L * HOST_MHZ;
+   }
+}
+
+int1 shows(const char *l1, const char *l2)
+{
+   return(!strcmp(hd_line(1), l1) && !strcmp(hd_line(2), l2));
+}
+
+int main(void)
+{
+   int w, i;
+   int32 at, last;
+
+   host_reset();
+   hd_reset();
+   CHECK(lcd_init());
+   puts_lcd("\fXin moi quet the\nThe hop le");
+   CHECK(shows("Xin moi quet the", "The hop le      "));
+
+   // idle: reads only
+   w = hd_writes;
+   ticks(1000);
+   CHECK(hd_writes == w && redraws == 0 && hd_lost == 0);
+
+   // two cells changed: rewritten within two rounds of the screen
+   hd_ddram[0x43] = '#';
+   hd_ddram[5] = '%';
+   ticks(2 * 3 * LCD_CELLS);
+   CHECK(shows("Xin moi quet the", "The hop le      "));
+   CHECK(hd_writes == w + 2 && redraws == 0);
+
+   // application writes between the checks
+   lcd_gotoxy(4,2);
+   puts_lcd("Hello");
+   ticks(7);
+   puts_lcd("!");
+   CHECK(shows("Xin moi quet the", "TheHello!e      "));
+
+   // after a write the counter is set before it is compared
+   i = hd_instructions;
+   hd_ac = 0x50;                        // not where lcd_after() puts it
+   host_cycles += 1000L * HOST_MHZ;     // the next tick, no longer busy
+   ticks(2);                            // status, then the move
+   CHECK(hd_instructions == i + 1 && redraws == 0);
+   CHECK(lcd_ac == hd_ac);
+   ticks(3 * LCD_CELLS);
+   CHECK(redraws == 0 && lcd_bad == 0);
+   printf("step: %.1f us average, %.1f us longest, over %ld steps\n",
+          step_sum / (double)steps / HOST_MHZ,
+          step_max / (double)HOST_MHZ, (long)steps);
+   CHECK(step_max <= 8 * HOST_MHZ);
+   lcd_gotoxy(1,1);
+   puts_lcd("Moi");
+   CHECK(shows("Moi moi quet the", "TheHello!e      "));
+
+   // ESD: 8-bit mode, the address and the RAM lost
+   hd_glitch();
+   ticks(100);
+   CHECK(redraws == 1 && hd_four && !lcd_fault);
+   CHECK(shows("Moi moi quet the", "TheHello!e      "));
+   w = hd_writes;
+   ticks(1000);
+   CHECK(hd_writes == w && redraws == 1);
+
+   // unplugged for two minutes
+   hd_dead = 1;
+   puts_lcd("\fTu choi");
+   CHECK(lcd_fault);
+   redraws = 0;
+   spent = 0;
+   ticks(120000L);
+   printf("display dead for 120 s: %d retries, %.0f ms in lcd_scrub()\n",
+          redraws, spent / (HOST_MHZ * 1000.0));
+   CHECK(redraws == 9);
+   CHECK(lcd_retry <= (int16)LCD_RETRY << LCD_RETRY_MAX);
+
+   // plugged back in: found by the next retry
+   hd_reset();
+   redraws = 0;
+   for(at=0;at<40000L && (redraws == 0 || lcd_fault);++at)
+      ticks(1);
+   printf("display back: redrawn after %ld ms\n", (long)at);
+   CHECK(!lcd_fault && redraws == 1);
+   CHECK(shows("Tu choi         ", "                "));
+   CHECK(lcd_tries == 0 && lcd_retry == LCD_RETRY);
+
+   // a second fault starts from the short wait again
+   hd_dead = 1;
+   puts_lcd("\f");
+   redraws = 0;
+   for(last=0;last<1000 && redraws == 0;++last)
+      ticks(1);
+   CHECK(last == LCD_RETRY);
+   return(host_failed != 0);
+}
@@ -0,0 +1,14 @@
+#!/bin/sh
+# The driver against the golden bus traces: the same transfers for every
+# screen of the lcdtrace corpus, the same DDRAM, no timing violations.
+# After a deliberate protocol change, refresh golden/ with
+#     lcdtrace golden > golden/screens.out
+
+$HOSTCC -o "$OUT/lcdtrace" lcdtrace.c || exit 1
+"$OUT/lcdtrace" "$OUT" > "$OUT/screens.out"
+fail=$?
+for g in golden/*.trace; do
+   python3 lcddiff.py "$g" "$OUT/$(basename "$g")" || fail=1
+done
+diff -u golden/screens.out "$OUT/screens.out" || fail=1
+exit $fail
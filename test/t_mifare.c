@@ -0,0 +1,194 @@
+// mifare.c on a modelled reader and card.  MFRC522_Auth and MFRC522_Read
+// stand in for the reader library: they count the register accesses the
+// library makes, at about 250 cycles each over the bit-banged SPI, and
+// poll through the time the frames are on air at 106 kbit/s (9 bit times
+// of 9.44 us per byte, 100 us for the card to answer).  The card checks
+// the key and that a read falls in the sector it authenticated.
+//
+// A card is granted only with a programmed key and site code, its blocks
+// bound to its uid, and the uid enrolled as the user the card names.  An
+// admin card is handed on for prov.c whatever the store says.  The time
+// of the credential read is printed, in one sector and across two.
+
+#include "host.h"
+
+#define CRED_ROW     16
+#define CRED_STAGE   7
+
+#define SPI          250               // one register access
+#define AIR_BYTE     425               // 9 bit times at 106 kbit/s
+#define AIR_TURN     500               // frame delay before an answer
+
+#define MI_OK        0
+#define MI_ERR       2
+#define PICC_AUTHENT1A 0x60
+
+char card_key[6];
+char card[64][16];                      // blocks by number
+BYTE card_sector = 0xFF;                // sector authenticated, FF none
+int auths, reads;
+
+void spi(int n)
+{
+   host_cycles += (uint64_t)n * SPI;
+}
+
+// the library polls ComIrqReg until the exchange is over
+void air(int bytes, int turns)
+{
+   uint64_t t = (uint64_t)bytes * AIR_BYTE + (uint64_t)turns * AIR_TURN;
+
+   host_cycles += (t + SPI - 1) / SPI * SPI;
+}
+
+void MFRC522_Wr(BYTE reg, BYTE v)
+{
+   spi(1);
+   if(reg == 0x08 && !(v & 0x08))       // Crypto1 off
+      card_sector = 0xFF;
+}
+
+BYTE MFRC522_Rd(BYTE reg)
+{
+   spi(1);
+   return(reg == 0x08 && card_sector != 0xFF ? 0x08 : 0);
+}
+
+// setup, 12 FIFO writes, command; three passes on air; Status2Reg
+BYTE MFRC522_Auth(BYTE mode, BYTE block, char *key, char *uid)
+{
+   ++auths;
+   spi(8 + 12 + 1);
+   air(4 + 4 + 8 + 4, 3);
+   spi(5);
+   card_sector = 0xFF;
+   if(mode != PICC_AUTHENT1A || memcmp(key, card_key, 6) ||
+      memcmp(uid, card[0], 4))
+      return(MI_ERR);
+   card_sector = block >> 2;
+   return(MI_OK);
+}
+
+// CalulateCRC over the command, then a transceive of 4 bytes for 18
+BYTE MFRC522_Read(BYTE block, char *out)
+{
+   ++reads;
+   spi(9);
+   spi(8 + 4 + 3);
+   air(4 + 18, 1);
+   spi(5 + 18);
+   if((block >> 2) != card_sector)
+      return(MI_ERR);
+   memcpy(out, card[block], 16);
+   out[16] = out[17] = 0;               // CRC, not checked by the caller
+   return(MI_OK);
+}
+
+#include <overlay.c>
+#include <cred.c>
+#include <mifare.c>
+
+char uid[4] = {0xC0, 0xFF, 0xEE, 0x01};
+
+// site key and code in EEPROM, as provisioning leaves them
+void program(void)
+{
+   memcpy(host_ee + MF_EE_KEY, "\xA0\xA1\xA2\xA3\xA4\xA5", 6);
+   host_ee[MF_EE_SITE] = 0x12;
+   host_ee[MF_EE_SITE+1] = 0x34;
+   mf_init();
+}
+
+// a card of the site, key and site code as given, naming user
+void make_card(const char *key, BYTE s0, BYTE s1, BYTE user)
+{
+   memset(card, 0, sizeof(card));
+   memcpy(card_key, key, 6);
+   memcpy(card[0], uid, 4);
+   card[MF_CRED_BLOCK][0] = s0;
+   card[MF_CRED_BLOCK][1] = s1;
+   card[MF_CRED_BLOCK][2] = user;
+   memcpy(card[MF_CRED_BLOCK+1], uid, 4);
+}
+
+int1 tap(BYTE *user)
+{
+   int1 ok;
+
+   ok = mf_cred(uid, user);
+   mf_end();
+   return(ok);
+}
+
+double us(uint64_t c)
+{
+   return(c / (double)HOST_MHZ);
+}
+
+int main(void)
+{
+   char blk[MF_READ_MAX*16+2];
+   uint64_t t;
+   BYTE user;
+
+   host_reset();
+   cred_init();
+
+   // erased EEPROM: the factory key and site FFFF are not a site
+   mf_init();
+   CHECK(!mf_set);
+   make_card("\xFF\xFF\xFF\xFF\xFF\xFF", 0xFF, 0xFF, 5);
+   cred_stage_add(uid, 5);
+   CHECK(cred_sync());
+   CHECK(!tap(&user));
+   host_ee[MF_EE_SITE] = 0x12;          // a site code, the key still erased
+   mf_init();
+   CHECK(!mf_set);
+   make_card("\xFF\xFF\xFF\xFF\xFF\xFF", 0x12, 0xFF, 5);
+   CHECK(!tap(&user));
+
+   // programmed: the card must name the user the store has for its uid
+   program();
+   CHECK(mf_set);
+   make_card("\xA0\xA1\xA2\xA3\xA4\xA5", 0x12, 0x34, 5);
+   CHECK(tap(&user) && user == 5);
+   card[MF_CRED_BLOCK][2] = 6;
+   CHECK(!tap(&user));
+   cred_stage_del(uid);
+   CHECK(cred_sync());
+   card[MF_CRED_BLOCK][2] = 5;
+   CHECK(!tap(&user));
+
+   // the wrong key, site or uid copy
+   make_card("\xA0\xA1\xA2\xA3\xA4\x00", 0x12, 0x34, 5);
+   CHECK(!tap(&user));
+   make_card("\xA0\xA1\xA2\xA3\xA4\xA5", 0x12, 0x35, 5);
+   CHECK(!tap(&user));
+   make_card("\xA0\xA1\xA2\xA3\xA4\xA5", 0x12, 0x34, 5);
+   card[MF_CRED_BLOCK+1][3] ^= 1;
+   CHECK(!tap(&user));
+
+   // admin card: passed to prov.c, which checks its MAC
+   make_card("\xA0\xA1\xA2\xA3\xA4\xA5", 0x12, 0x34, MF_ADMIN);
+   CHECK(tap(&user) && user == MF_ADMIN);
+
+   // the read time: one sector, then two with a trailer between
+   auths = reads = 0;
+   t = host_cycles;
+   CHECK(mf_read_blocks(uid, MF_CRED_BLOCK, 2, blk));
+   t = host_cycles - t;
+   mf_end();
+   CHECK(auths == 1 && reads == 2);
+   printf("blocks 4-5, one sector:  %5.0f us, %d auth %d reads\n",
+          us(t), auths, reads);
+   auths = reads = 0;
+   t = host_cycles;
+   CHECK(mf_read_blocks(uid, 6, MF_READ_MAX, blk));
+   t = host_cycles - t;
+   mf_end();
+   CHECK(auths == 2 && reads == 2);
+   printf("blocks 6 and 8, two:     %5.0f us, %d auths %d reads\n",
+          us(t), auths, reads);
+   CHECK(us(t) < 20000);                // of the 150 ms grant path
+   return(host_failed != 0);
+}
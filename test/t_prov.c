@@ -0,0 +1,108 @@
+// prov.c on a card image: a signed card is applied once, and a card is
+// refused whole when a record names a user number the store cannot hold,
+// writes EEPROM outside PROV_EE_LO..PROV_EE_HI, or when its seq is
+// 0xFFFF, which would read back as erased.
+
+#include "host.h"
+
+#define PROV_CARD
+#define CRED_ROW     16
+#define CRED_STAGE   7
+
+#define MF_ADMIN     0xFF
+
+char mf_site[2] = {0x12, 0x34};
+char card[64][16];                  // blocks by number
+
+int1 mf_read_blocks(char uid[], BYTE first, BYTE count, char *out)
+{
+   (void)uid;
+   for(; count; ++first)
+   {
+      if((first & 3) == 3)
+         continue;
+      memcpy(out, card[first], 16);
+      out += 16;
+      --count;
+   }
+   return(TRUE);
+}
+
+#include <overlay.c>
+#include <cred.c>
+#include <prov.c>
+
+// MAC over the header and records, into the block after them
+void sign(void)
+{
+   BYTE i;
+
+   prov_load_key();
+   prov->mac[0] = prov->mac[1] = 0;
+   for(i=0;i<3;++i)
+      prov_chain(card[prov_block(i)]);
+   for(i=0;i<8;++i)
+      card[prov_block(3)][i] = make8(prov->mac[i >> 2], 3 - (i & 3));
+}
+
+// Header, one add record for user, EEPROM byte ee = 0xA5, and the MAC
+void make_card(int16 seq, BYTE user, BYTE ee)
+{
+   memset(card, 0, sizeof(card));
+   memcpy(card[prov_block(0)], "PV\0\0\x12\x34\x02", 7);
+   card[prov_block(0)][2] = make8(seq,1);
+   card[prov_block(0)][3] = make8(seq,0);
+   memcpy(card[prov_block(1)], "\x01\xC0\xFF\xEE\x01", 5);
+   card[prov_block(1)][5] = user;
+   memcpy(card[prov_block(2)], "\x03\x70\x01\xA5", 4);
+   card[prov_block(2)][1] = ee;
+   sign();
+}
+
+int main(void)
+{
+   char uid[4] = {0xC0, 0xFF, 0xEE, 0x01};
+   BYTE i, user;
+
+   host_reset();
+   for(i=0;i<16;++i)
+      host_ee[PROV_EE_KEY+i] = 0x11 * i;
+   cred_init();
+
+   make_card(1, 64, 0x70);              // 6 bits would alias user 0
+   CHECK(!prov_card(uid));
+   CHECK(!cred_find(uid, &user) && host_ee[0x70] == 0xFF);
+
+   make_card(0xFFFF, 5, 0x70);
+   CHECK(!prov_card(uid));
+   CHECK(!cred_find(uid, &user) && host_ee[0x70] == 0xFF);
+
+   make_card(1, 63, 0x70);
+   CHECK(prov_card(uid));
+   CHECK(cred_find(uid, &user) && user == 63 && host_ee[0x70] == 0xA5);
+   CHECK(!prov_card(uid));              // same seq again
+
+   make_card(2, 7, 0x70);
+   card[prov_block(1)][5] ^= 1;         // changed after signing
+   CHECK(!prov_card(uid));
+   make_card(2, 7, 0x70);
+   CHECK(prov_card(uid));
+   CHECK(cred_find(uid, &user) && user == 7);
+
+   // signed, but aimed at the keys, the store's bank switch, or past
+   // the end of EEPROM
+   make_card(3, 8, PROV_EE_KEY);
+   CHECK(!prov_card(uid) && host_ee[PROV_EE_KEY] == 0);
+   make_card(3, 8, CRED_EE_BANK);
+   CHECK(!prov_card(uid));
+   make_card(3, 8, 0x06);               // mifare.c site code
+   CHECK(!prov_card(uid));
+   make_card(3, 8, 0xFF);
+   card[prov_block(2)][2] = 2;          // 0xFF and 0x00
+   sign();
+   CHECK(!prov_card(uid) && host_ee[0] == 0xFF);
+   make_card(3, 8, PROV_EE_LO);
+   CHECK(prov_card(uid) && host_ee[PROV_EE_LO] == 0xA5);
+   CHECK(cred_find(uid, &user) && user == 8);
+   return(host_failed != 0);
+}
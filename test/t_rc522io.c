@@ -0,0 +1,165 @@
+// rc522_finish() on a modelled MFRC522: the answer comes into the 64 byte
+// FIFO a byte at a time as it arrives on air, and every register access
+// costs the 250 cycles of the bit-banged SPI.  A frame longer than the
+// FIFO must be drained while it is still arriving and come out whole and
+// in order, CRC_A checked and stripped.  Where the drain cannot keep up
+// the FIFO overflows, and that must fail the frame, not cut it short.
+// The deepest the FIFO got is printed for each bit rate.
+
+#include "host.h"
+
+#define SPI          250               // one register access
+#define AIR_TURN     500               // frame delay before the answer
+
+BYTE frame[256];                        // answer on air, CRC included
+int nframe, air_byte;                   // its length, cycles per byte
+uint64_t t0;                            // when its first byte arrives
+BYTE fifo[64];
+int in, out, level, peak;               // bytes arrived, read, held
+int1 started, ovfl;
+
+// bytes that have arrived by now go into the FIFO, or are lost
+void rc_update(void)
+{
+   int arrived;
+
+   if(!started || host_cycles < t0)
+      return;
+   arrived = (host_cycles - t0) / air_byte;
+   if(arrived > nframe)
+      arrived = nframe;
+   for(; in<arrived; ++in)
+      if(level < 64)
+      {
+         fifo[(out + level) & 63] = frame[in];
+         if(++level > peak)
+            peak = level;
+      }
+      else
+         ovfl = 1;
+}
+
+void MFRC522_Wr(BYTE reg, BYTE v)
+{
+   host_cycles += SPI;
+   rc_update();
+   switch(reg)
+   {
+      case 0x0A:                        // FIFOLevelReg: flush
+         if(v & 0x80)
+            level = 0;
+         break;
+      case 0x0D:                        // BitFramingReg: StartSend
+         if(v & 0x80)
+         {
+            t0 = host_cycles + AIR_TURN;
+            in = 0;
+            started = 1;
+         }
+         break;
+   }
+}
+
+BYTE MFRC522_Rd(BYTE reg)
+{
+   BYTE c;
+
+   host_cycles += SPI;
+   rc_update();
+   switch(reg)
+   {
+      case 0x04:                        // ComIrqReg: RxIRq once all in
+         return(started && in == nframe ? 0x30 : 0);
+      case 0x06:                        // ErrorReg: BufferOvfl
+         return(ovfl ? 0x10 : 0);
+      case 0x0A:
+         return(level);
+      case 0x09:
+         if(!level)
+            return(0);
+         c = fifo[out];
+         out = (out + 1) & 63;
+         --level;
+         return(c);
+   }
+   return(0);
+}
+
+#include <rc522io.c>
+
+// an answer of n data bytes, CRC_A appended, at kbit/s
+void answer(int n, int kbits)
+{
+   int i;
+
+   rc_crc = 0x6363;
+   for(i=0;i<n;++i)
+   {
+      frame[i] = i * 7 + 3;
+      rc_crc_byte(frame[i]);
+   }
+   frame[n] = make8(rc_crc,0);
+   frame[n+1] = make8(rc_crc,1);
+   nframe = n + 2;
+   air_byte = 425 * 106 / kbits;        // 9 bit times of 128/fc at 106
+   started = ovfl = 0;
+   in = out = level = peak = 0;
+}
+
+int1 intact(char *rx, int n)
+{
+   int i;
+
+   for(i=0;i<n;++i)
+      if((BYTE)rx[i] != (BYTE)(i * 7 + 3))
+         return(FALSE);
+   return(TRUE);
+}
+
+int main(void)
+{
+   char tx[2] = {0x30, 0x04}, rx[RC522_FRAME];
+   int kbits;
+
+   host_reset();
+
+   // a whole FSD 128 frame, at the rates the drain keeps up with
+   for(kbits=106;kbits<=212;kbits*=2)
+   {
+      answer(RC522_FRAME - 2, kbits);
+      rc522_start(tx, 2, 1);
+      CHECK(rc522_finish(rx, RC522_FRAME, 1) == RC522_FRAME - 2);
+      CHECK(intact(rx, RC522_FRAME - 2) && !ovfl);
+      printf("%3d kbit/s: %d byte frame, FIFO at most %d deep\n",
+             kbits, nframe, peak);
+      CHECK(peak < 64);
+   }
+
+   // 424 kbit/s outruns 50 us a byte: the FIFO overflows, the frame fails
+   answer(RC522_FRAME - 2, 424);
+   rc522_start(tx, 2, 1);
+   CHECK(rc522_finish(rx, RC522_FRAME, 1) == RC_FAIL && ovfl);
+   printf("424 kbit/s: %d byte frame overflows the FIFO\n", nframe);
+
+   // but a frame the FIFO holds whole is fine at any rate
+   answer(62, 848);
+   rc522_start(tx, 2, 1);
+   CHECK(rc522_finish(rx, RC522_FRAME, 1) == 62 && intact(rx, 62));
+
+   // longer than the caller's buffer
+   answer(20, 106);
+   rc522_start(tx, 2, 1);
+   CHECK(rc522_finish(rx, 18, 1) == RC_FAIL);
+
+   // a corrupted byte fails the CRC
+   answer(100, 106);
+   frame[70] ^= 0x01;
+   rc522_start(tx, 2, 1);
+   CHECK(rc522_finish(rx, RC522_FRAME, 1) == RC_FAIL);
+
+   // no CRC: what came is what is returned
+   answer(3, 106);
+   rc522_start(tx, 2, 0);
+   CHECK(rc522_finish(rx, RC522_FRAME, 0) == 5 && intact(rx, 3));
+   return(host_failed != 0);
+}
@@ -0,0 +1,228 @@
+// rtc.c against a DS1307 stand-in on the I2C calls.  The chip keeps BCD
+// time and calendar, copies them to its read buffer at every START and
+// pulls SQW low once a second, which runs rtc_isr() when INT_EXT is on
+// and leaves the flag pending when it is not.
+//
+// Two days from Feb 28 23:59:30 of a leap year: the RAM copy must match
+// the chip after every second, across midnight and the month end.  A
+// lost edge must be put right by the next drift read, an edge during a
+// read must not be counted twice, a halted oscillator is restarted, and
+// a chip that does not answer clears rtc_ok until it answers again.
+
+#include "host.h"
+
+BYTE ext_flag;
+
+#undef clear_interrupt
+#define clear_interrupt(i)  ((i) == INT_EXT ? ext_flag = 0 : 0)
+
+// The chip
+BYTE reg[64], buf[7], ptr, nbytes;
+int1 dead, mute;
+int edge_in_read;                   // SQW edge on this i2c_read, 0 none
+int reads;
+
+BYTE bcd(BYTE v)
+{
+   return((v / 10) << 4 | (v % 10));
+}
+
+BYTE bin(BYTE v)
+{
+   return((v >> 4) * 10 + (v & 0x0F));
+}
+
+void chip_set(BYTE y, BYTE mo, BYTE d, BYTE dow, BYTE h, BYTE mi, BYTE s)
+{
+   reg[0] = bcd(s);
+   reg[1] = bcd(mi);
+   reg[2] = bcd(h);
+   reg[3] = dow;
+   reg[4] = bcd(d);
+   reg[5] = bcd(mo);
+   reg[6] = bcd(y);
+}
+
+void sqw(void);
+
+// One second on the chip, then the SQW edge
+void chip_tick(void)
+{
+   static const BYTE mdays[13] = {0,31,28,31,30,31,30,31,31,30,31,30,31};
+   BYTE s = bin(reg[0] & 0x7F), mi = bin(reg[1]), h = bin(reg[2] & 0x3F);
+   BYTE d = bin(reg[4]), mo = bin(reg[5]), y = bin(reg[6]), dow = reg[3];
+   BYTE last = mdays[mo] + (mo == 2 && y % 4 == 0);
+
+   if(reg[0] & 0x80)                // CH: oscillator stopped
+      return;
+   if(++s == 60)
+   {
+      s = 0;
+      if(++mi == 60)
+      {
+         mi = 0;
+         if(++h == 24)
+         {
+            h = 0;
+            dow = dow % 7 + 1;
+            if(++d > last)
+            {
+               d = 1;
+               if(++mo > 12)
+               {
+                  mo = 1;
+                  y = (y + 1) % 100;
+               }
+            }
+         }
+      }
+   }
+   chip_set(y, mo, d, dow, h, mi, s);
+   if(mute)
+      mute = 0;                     // this edge never reaches RB0
+   else
+      sqw();
+}
+
+void i2c_start(void)
+{
+   memcpy(buf, reg, 7);             // registers latched at START
+   nbytes = 0;
+}
+
+void i2c_stop(void)
+{
+}
+
+BYTE i2c_write(BYTE b)
+{
+   if(dead)
+      return(1);                    // no ACK
+   if(nbytes++ == 0)
+      return((b & 0xFE) != 0xD0);    // RTC_ADDR, read or write
+   if(nbytes == 2)
+      ptr = b;
+   else
+      reg[ptr++ & 0x3F] = b;
+   return(0);
+}
+
+BYTE i2c_read(BYTE ack)
+{
+   BYTE b = ptr < 7 ? buf[ptr] : reg[ptr & 0x3F];
+
+   (void)ack;
+   if(ptr++ == 0)
+      ++reads;
+   if(edge_in_read && ptr == edge_in_read)
+   {
+      edge_in_read = 0;
+      chip_tick();                  // the chip moves on mid-read
+   }
+   return(b);
+}
+
+#include <isr_stat.c>
+#include <rtc.c>
+
+void sqw(void)
+{
+   ext_flag = 1;
+   if(host_ie & INT_EXT)
+   {
+      ext_flag = 0;
+      rtc_isr();
+   }
+}
+
+// Pending edge once INT_EXT is back on
+void deliver(void)
+{
+   if(ext_flag && (host_ie & INT_EXT))
+   {
+      ext_flag = 0;
+      rtc_isr();
+   }
+}
+
+int1 same(void)
+{
+   RTC_TIME t;
+
+   rtc_get(&t);
+   return(t.sec == bin(reg[0] & 0x7F) && t.min == bin(reg[1]) &&
+          t.hour == bin(reg[2] & 0x3F) && t.dow == reg[3] &&
+          t.day == bin(reg[4]) && t.mon == bin(reg[5]) &&
+          t.year == bin(reg[6]));
+}
+
+int main(void)
+{
+   int32 s, wrong = 0, fixed_at = 0;
+
+   host_reset();
+   chip_set(24, 2, 28, 3, 23, 59, 30);
+   reg[0] |= 0x80;                  // battery was changed: CH set
+   rtc_init();
+   CHECK(rtc_ok);
+   CHECK(!(reg[0] & 0x80));         // oscillator restarted
+   CHECK(same());
+
+   // two days, second by second
+   for(s=0;s<2*86400L;++s)
+   {
+      chip_tick();
+      rtc_poll();
+      deliver();
+      if(!same())
+         ++wrong;
+   }
+   CHECK(wrong == 0);
+   CHECK(rtc.day == 1 && rtc.mon == 3 && rtc.dow == 5);
+
+   // a lost edge: one second behind until the next drift read
+   mute = 1;
+   chip_tick();
+   CHECK(!same());
+   for(s=1;s<=RTC_SYNC_MIN*60L && !fixed_at;++s)
+   {
+      chip_tick();
+      rtc_poll();
+      deliver();
+      if(same())
+         fixed_at = s;
+   }
+   CHECK(fixed_at > 0);
+   printf("lost edge put right after %ld s\n", (long)fixed_at);
+
+   // an edge between the START and the last byte of a read
+   reads = 0;
+   edge_in_read = 3;
+   rtc_stale = 1;
+   rtc_poll();
+   deliver();
+   CHECK(reads == 1 && !edge_in_read);
+   CHECK(same());
+
+   // a dead chip: rtc_ok falls, the copy runs on, the chip is retried
+   dead = 1;
+   rtc_stale = 1;
+   rtc_poll();
+   CHECK(!rtc_ok);
+   for(s=0;s<600;++s)
+   {
+      chip_tick();
+      rtc_poll();
+      deliver();
+   }
+   CHECK(same());
+   dead = 0;
+   for(s=0;s<RTC_SYNC_MIN*60L && !rtc_ok;++s)
+   {
+      chip_tick();
+      rtc_poll();
+      deliver();
+   }
+   CHECK(rtc_ok && same());
+   return(host_failed != 0);
+}
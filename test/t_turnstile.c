@@ -0,0 +1,70 @@
+// Turnstile queue on the 1 ms tick: taps served per minute for a queue of
+// people tapping at a steady pace, and for a group arriving at once.
+// Every strike pulse must be TS_PULSE_MS long with at least TS_REARM_MS
+// off before the next one.
+
+#include "host.h"
+#include <turnstile.c>
+
+int32 now;                          // ms
+int32 rise, fall;
+int pulses, short_pulse, short_gap;
+
+void strike(BYTE pin, BYTE v)
+{
+   if(pin != TS_PIN)
+      return;
+   if(v)
+   {
+      if(pulses && now - fall < TS_REARM_MS)
+         ++short_gap;
+      rise = now;
+      return;
+   }
+   fall = now;
+   ++pulses;
+   if(fall - rise != TS_PULSE_MS)
+      ++short_pulse;
+}
+
+void run(const char *name, int32 every, int taps, int32 minutes)
+{
+   int32 next = 0;
+   int tapped = 0, refused = 0;
+
+   host_reset();
+   host_edge = strike;
+   ts_queue = 0;
+   ts_timer = 0;
+   ts_pulse = 0;
+   ts_served = 0;
+   pulses = short_pulse = short_gap = 0;
+   for(now=0;now<minutes*60000;++now)
+   {
+      if(tapped < taps && now == next)
+      {
+         if(!ts_grant())
+            ++refused;
+         ++tapped;
+         next += every;
+      }
+      ts_isr();
+   }
+   printf("%-22s %4d taps %4d refused %6.1f served/min\n", name, tapped,
+          refused, ts_served / (double)minutes);
+   CHECK(ts_served == pulses);
+   CHECK(short_pulse == 0 && short_gap == 0);
+   CHECK(ts_served + ts_queue + ts_pulse == tapped - refused);
+}
+
+int main(void)
+{
+   run("one tap per 2.0 s", 2000, 10000, 10);
+   run("one tap per 1.5 s", 1500, 10000, 10);
+   run("one tap per 1.0 s", 1000, 10000, 10);
+   run("one tap per 0.8 s", 800, 10000, 10);
+   run("one tap per 0.5 s", 500, 10000, 10);
+   run("group of 12, 0.3 s", 300, 12, 1);
+   run("group of 12 at once", 1, 12, 1);
+   return(host_failed != 0);
+}
@@ -0,0 +1,110 @@
+// utf8.c over a corpus of staff names, with UTF8_CGRAM on.  The LCD calls
+// are stubbed: lcd_putc() collects the screen text (CGRAM characters as
+// '0'-'7'), lcd_send_byte() the glyphs utf8_init() loads.  Every name
+// must fold to the expected text, broken sequences included, and the
+// decode rate over the corpus is printed.
+
+#include "host.h"
+#include <time.h>
+
+char screen[64];
+int shown, glyphs;
+int1 to_cgram;
+int32 sink;
+
+void lcd_putc(char c)
+{
+   if(shown < (int)sizeof(screen) - 1)
+      screen[shown++] = c < 8 ? '0' + c : c;
+   sink += c;
+}
+
+void lcd_send_byte(BYTE address, BYTE n)
+{
+   if(!address)
+      to_cgram = (n & 0xC0) == 0x40;
+   else if(to_cgram)
+      ++glyphs;
+}
+
+void lcd_gotoxy(BYTE x, BYTE y)
+{
+   (void)x;
+   (void)y;
+   to_cgram = 0;
+}
+
+#define UTF8_CGRAM
+#include <utf8.c>
+
+// name as stored, and as it must show
+const char *const NAMES[][2] = {
+   {"Nguy\xe1\xbb\x85n V\xc4\x83n \xc4\x90\xe1\xbb\xa9" "c",
+    "Nguy3n V0n 76c"},
+   {"Tr\xe1\xba\xa7n Th\xe1\xbb\x8b \xc3\x81nh Tuy\xe1\xba\xbft",
+    "Tr1n Thi Anh Tuy3t"},
+   {"Ph\xe1\xba\xa1m Ng\xe1\xbb\x8d" "c \xc6\xa0n", "Pham Ngoc On"},
+   {"L\xc3\xaa H\xe1\xbb\xafu \xc6\xaf\xe1\xbb\x9b" "c", "L3 H6u U5c"},
+   {"\xc4\x90\xe1\xba\xb7ng Qu\xe1\xbb\x91" "c Vi\xe1\xbb\x87t",
+    "70ng Qu4c Vi3t"},
+   {"H\xe1\xbb\x93 Th\xe1\xbb\x8b M\xe1\xbb\xb9 Dung", "H4 Thi My Dung"},
+   {"B\xc3\xb9i Xu\xc3\xa2n Ph\xc6\xb0\xe1\xbb\x9b" "c", "Bui Xu1n Ph65c"},
+   {"V\xc3\xb5 Th\xc3\xa0nh Trung", "Vo Thanh Trung"},
+   {"Tr\xc6\xb0\xc6\xa1ng Huy", "Tr65ng Huy"},
+   {"Ng\xc3\xb4 K\xe1\xbb\xb3 Anh", "Ng4 Ky Anh"},
+   {"M\xc3\xbcller \xc3\x86r\xc3\xb8 \xc3\x9f \xc3\xbf", "Muller Aro s y"},
+   {"Nguye\xcc\x82\xcc\x83n", "Nguyen"},            // decomposed marks
+   {"x\xe1\xbby", "x?y"},                          // cut short
+   {"\xbb" "ab\xe1\xbb", "ab?"},                   // stray, then cut at end
+   {"\xf0\x9f\x98\x80ok", "?ok"},                  // outside the BMP
+   {"\xe4\xb8\xad", "?"}};                         // no fold
+#define CORPUS  (int)(sizeof(NAMES) / sizeof(NAMES[0]))
+
+void show(const char *s)
+{
+   shown = 0;
+   while(*s)
+      utf8_putc(*s++);
+   utf8_putc(0);                        // end of string: flushes a cut one
+   screen[shown - 1] = 0;
+}
+
+int main(void)
+{
+   int i, k;
+   int32 bytes = 0;
+   clock_t t;
+   double dt;
+
+   utf8_init();
+   CHECK(glyphs == 64);
+
+   for(i=0;i<CORPUS;++i)
+   {
+      show(NAMES[i][0]);
+      if(strcmp(screen, NAMES[i][1]))
+      {
+         printf("%s: got %s, want %s\n", NAMES[i][0], screen, NAMES[i][1]);
+         CHECK(0);
+      }
+   }
+
+   t = clock();
+   for(k=0;k<100000;++k)
+      for(i=0;i<10;++i)
+      {
+         const char *s = NAMES[i][0];
+
+         shown = 0;
+         while(*s)
+         {
+            utf8_putc(*s++);
+            ++bytes;
+         }
+      }
+   dt = (double)(clock() - t) / CLOCKS_PER_SEC;
+   printf("%ld bytes of names in %.3f s: %.0f MB/s\n", (long)bytes, dt,
+          dt > 0 ? bytes / dt / 1e6 : 0);
+   CHECK(sink != 0);
+   return(host_failed != 0);
+}
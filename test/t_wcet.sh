@@ -0,0 +1,9 @@
+#!/bin/sh
+# wcet.py on the synthetic listing in wcet/, which holds one loop of each
+# kind wcet.py bounds: a for() over a #define from the sources, @wcet
+# with a name from wcet/defs.h, @wcet ... total, a delay call.  The
+# report must be t_wcet.out, with paths a and poll over budget, fast
+# under it by its path bound, and broken and odd unbounded.
+
+python3 ../wcet.py wcet/code1.lst wcet/wcet.txt --all
+[ $? -eq 1 ]
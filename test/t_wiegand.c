@@ -0,0 +1,115 @@
+// Wiegand output on a pin-trace model: Timer0 counts at 1.6 us and calls
+// wg_isr() on overflow, optionally some counts late as when another
+// handler is running.  The D0/D1 edges are timed and decoded back into
+// the frame, which must carry the data with both parities right, with
+// pulses of 20-100 us and 1-2 ms from one pulse to the next.
+
+#include "host.h"
+#include <isr_stat.c>
+#include <wiegand.c>
+
+#define COUNT_US    1.6
+
+int32 count;                        // Timer0 counts since the start
+int32 fell[40], rose[40];
+BYTE bit[40];
+int npulse, bad_level;
+
+void edge(BYTE pin, BYTE v)
+{
+   BYTE other = pin == WG_D0 ? WG_D1 : WG_D0;
+
+   if(pin != WG_D0 && pin != WG_D1)
+      return;
+   if(!v)
+   {
+      if(!(host_port[HOST_REG(other)] & HOST_MASK(other)) || npulse >= 40)
+         ++bad_level;                   // both low at once
+      else
+      {
+         fell[npulse] = count;
+         bit[npulse] = pin == WG_D1;
+      }
+      return;
+   }
+   if(npulse < 40)
+      rose[npulse++] = count;
+}
+
+// Run Timer0 until the frame is out; late = counts from the overflow to
+// the handler's set_timer0()
+void run(BYTE late)
+{
+   int32 end;
+
+   for(end=0; end < 200000; ++end, ++count)
+   {
+      if(++host_tmr0)
+         continue;
+      if(!(host_ie & INT_RTCC))
+         break;
+      count += late;
+      host_tmr0 = late;
+      wg_isr();
+   }
+}
+
+void frame(char *data, BYTE n, BYTE late)
+{
+   BYTE i, even = 0, odd = 1, got[5] = {0};
+   double w, wmin = 1e9, wmax = 0, gmin = 1e9, gmax = 0;
+
+   host_reset();
+   wg_init();
+   host_edge = edge;
+   count = 0;
+   npulse = bad_level = 0;
+   CHECK(wg_send(data, n));
+   CHECK(!wg_send(data, n));            // busy until the frame is out
+   run(late);
+
+   CHECK(npulse == n && bad_level == 0);
+   for(i=0;i<npulse;++i)
+   {
+      w = (rose[i] - fell[i]) * COUNT_US;
+      if(w < wmin) wmin = w;
+      if(w > wmax) wmax = w;
+      if(i)
+      {
+         w = (fell[i] - fell[i-1]) * COUNT_US / 1000;
+         if(w < gmin) gmin = w;
+         if(w > gmax) gmax = w;
+      }
+      if(i && i < n-1 && bit[i])
+         got[(i-1)>>3] |= 0x80 >> ((i-1)&7);
+      if(i && i <= (n-2)/2 && bit[i])
+         even ^= 1;
+      if(i > (n-2)/2 && i < n-1 && bit[i])
+         odd ^= 1;
+   }
+   CHECK(bit[0] == even && bit[n-1] == odd);
+   CHECK(!memcmp(got, data, (n-2)/8));
+   if((n-2)%8)
+      CHECK((got[(n-2)/8] ^ data[(n-2)/8]) >> (8 - (n-2)%8) == 0);
+   CHECK(wmin >= 20 && wmax <= 100);
+   CHECK(gmin >= 1 && gmax <= 2);
+   CHECK(!wg_left && !wg_low && !wg_gap);   // free for the next frame
+   printf("%d bits, handler %2d counts late: pulse %5.1f-%5.1f us, "
+          "pulse to pulse %.3f-%.3f ms, frame %.1f ms\n", n, late,
+          wmin, wmax, gmin, gmax, rose[n-1] * COUNT_US / 1000);
+}
+
+int main(void)
+{
+   char d[4] = {0xD3, 0x4D, 0xFC, 0x27};
+   char ones[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+   char zeros[4] = {0, 0, 0, 0};
+
+   frame(d, 26, 0);
+   frame(d, 34, 0);
+   frame(ones, 34, 0);
+   frame(zeros, 26, 0);
+   frame(d, 34, 10);
+   frame(d, 34, 25);
+   return(host_failed != 0);
+}
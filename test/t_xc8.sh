@@ -0,0 +1,7 @@
+#!/bin/sh
+# The XC8 build of code1.c through gcc: no __PCM__, so compat.h and the
+# #else sides of the CCS directives are used.  xcstub/xc.h stands in for
+# the device header and stub/Built_in.h for the reader library.  A syntax
+# and type check only; nothing is linked or run.
+
+$HOSTCC -fsyntax-only -Wno-unknown-pragmas -Ixcstub -Istub ../code1.c
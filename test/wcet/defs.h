@@ -0,0 +1,5 @@
+// Names for the loops in code1.lst, found beside the listing
+#define RUNS      6           // passes of burst()
+#define BURST     (RUNS/2)    /* RUNS/2, not RUNS */
+#define BROKEN    (RUNS/0)
+#define ODD       (RUNS*)
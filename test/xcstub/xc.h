@@ -0,0 +1,23 @@
+// Stand-in for the XC8 device header, enough for gcc to check the syntax
+// of the XC8 build of code1.c (t_xc8.sh).  Declarations only; nothing
+// built against it runs.
+
+#define __interrupt(...)
+
+extern volatile unsigned char PORTA, PORTB, PORTC, PORTD, PORTE;
+extern volatile unsigned char TRISA, TRISB, TRISC, TRISD, TRISE, WPUB;
+extern volatile unsigned char PR2, T2CON, TMR2, T1CON, TMR1H, TMR1L;
+extern volatile unsigned char ANSEL, ANSELH;
+extern volatile unsigned char EEADR, EEADRH, EEDAT, EEDATH, EECON2;
+
+extern volatile struct { unsigned GIE:1, PEIE:1; } INTCONbits;
+extern volatile struct { unsigned TMR2IE:1; } PIE1bits;
+extern volatile struct { unsigned TMR2IF:1; } PIR1bits;
+extern volatile struct { unsigned EEPGD:1, WREN:1, WR:1, RD:1; } EECON1bits;
+
+void NOP(void);
+void _delay(unsigned long n);
+void __delay_us(unsigned long n);
+void __delay_ms(unsigned long n);
+unsigned char eeprom_read(unsigned char a);
+void eeprom_write(unsigned char a, unsigned char v);
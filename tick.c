@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////
+////                             TICK.C                                ////
+////                   1 ms system tick on Timer2                      ////
+////                                                                   ////
+////  tick_init()   Start Timer2 at 1 kHz (20 MHz clock).  The         ////
+////                #int_timer2 handler lives in the application and   ////
+////                must call tick_isr().                              ////
+////                                                                   ////
+////  tick_now()    Milliseconds since tick_init(), wrapping at 65536. ////
+////                                                                   ////
+////  tick_since(t) Milliseconds elapsed since tick value t.           ////
+///////////////////////////////////////////////////////////////////////////
+
+int16 tick_ms = 0;
+
+void tick_init(void)
+{
+   setup_timer_2(T2_DIV_BY_4, 249, 5);     // 5MHz/4/250/5 = 1kHz
+   enable_interrupts(INT_TIMER2);
+}
+
+#ifdef __PCM__
+#inline
+#endif
+void tick_isr(void)
+{
+   ++tick_ms;
+}
+
+int16 tick_now(void)
+{
+   int16 t;
+
+   disable_interrupts(INT_TIMER2);
+   t = tick_ms;
+   enable_interrupts(INT_TIMER2);
+   return(t);
+}
+
+int16 tick_since(int16 t)
+{
+   return(tick_now() - t);
+}
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////
+////                           TURNSTILE.C                             ////
+////             Queued strike pulses for back-to-back taps            ////
+////                                                                   ////
+////  ts_grant()    Queue one relay pulse.  Returns FALSE when         ////
+////                TS_QUEUE grants are already waiting.               ////
+////                                                                   ////
+////  ts_isr()      Call from the 1 ms tick.  Runs the pulse, then     ////
+////                holds the relay off for TS_REARM_MS before the     ////
+////                next queued pulse.                                 ////
+////                                                                   ////
+////  ts_served     Pulses delivered since power-up.                   ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef TS_PIN
+   #define TS_PIN         PIN_C1
+#endif
+#ifndef TS_PULSE_MS
+   #define TS_PULSE_MS    500      // strike on per grant
+   #define TS_REARM_MS    300      // strike off before the next pulse
+#endif
+#ifndef TS_QUEUE
+   #define TS_QUEUE       8
+#endif
+
+BYTE ts_queue = 0;                  // grants waiting for the relay
+int16 ts_timer = 0;                 // ms left in the pulse or re-arm
+int1 ts_pulse = 0;                  // relay energized
+int16 ts_served = 0;
+
+int1 ts_grant(void)
+{
+   int1 ok = FALSE;
+
+   disable_interrupts(INT_TIMER2);
+   if(ts_queue < TS_QUEUE)
+   {
+      ++ts_queue;
+      ok = TRUE;
+   }
+   enable_interrupts(INT_TIMER2);
+   return(ok);
+}
+
+#ifdef __PCM__
+#inline
+#endif
+void ts_isr(void)
+{
+   if(ts_timer)
+   {
+      if(--ts_timer)
+         return;
+      if(ts_pulse)
+      {
+         output_low(TS_PIN);
+         ts_pulse = 0;
+         ts_timer = TS_REARM_MS;
+         ++ts_served;
+         return;
+      }
+   }
+   if(ts_queue)
+   {
+      --ts_queue;
+      output_high(TS_PIN);
+      ts_pulse = 1;
+      ts_timer = TS_PULSE_MS;
+   }
+}
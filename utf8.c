@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////
+////                             UTF8.C                                ////
+////            UTF-8 text on the HD44780 character set                ////
+////                                                                   ////
+////  utf8_putc(c)  Feed one byte of UTF-8 text.  Each character is    ////
+////                passed to lcd_putc as soon as its last byte is     ////
+////                in: ASCII as is, Vietnamese and other Latin        ////
+////                letters folded to the base letter, combining       ////
+////                marks dropped, anything else as '?'.  Only the     ////
+////                character being decoded is kept, so a name can    ////
+////                be drawn straight from where it is stored.         ////
+////                                                                   ////
+////  utf8_init()   Start a new string.  With UTF8_CGRAM defined,      ////
+////                also load the letters a-breve, a-, e- and          ////
+////                o-circumflex, o- and u-horn, d- and D-stroke into  ////
+////                the eight CGRAM characters, so they keep their     ////
+////                shape and only the tone mark is lost.  Call after  ////
+////                lcd_init() and before anything is drawn.           ////
+////                                                                   ////
+////  Only the ASCII letters shared by the A00 and A02 ROMs are used.  ////
+///////////////////////////////////////////////////////////////////////////
+
+// Vietnamese letters, named as typed in Telex; the upper case is +1
+#define U8_AW     0x80              // a-breve
+#define U8_AA     0x82              // a-circumflex
+#define U8_DD     0x84              // d-stroke
+#define U8_EE     0x86              // e-circumflex
+#define U8_OO     0x88              // o-circumflex
+#define U8_OW     0x8A              // o-horn
+#define U8_UW     0x8C              // u-horn
+
+// Code point ranges and where their letters start in UTF8_FOLD.  Bit 7
+// of the count marks upper/lower case pairs sharing one (upper) letter.
+#define UTF8_RANGES  8
+int16 const UTF8_FIRST[UTF8_RANGES] =
+   {0x00C0, 0x0102, 0x0110, 0x0128, 0x0168, 0x01A0, 0x01AF, 0x1EA0};
+BYTE const UTF8_COUNT[UTF8_RANGES] =
+   {64,     0x82,   0x82,   0x82,   0x82,   0x82,   2,      0x80|90};
+BYTE const UTF8_AT[UTF8_RANGES] =
+   {0,      64,     65,     66,     67,     68,     69,     71};
+
+BYTE const UTF8_FOLD[116] = {
+   // U+00C0 Latin-1 upper case
+   'A','A',U8_AA+1,'A','A','A','A','C','E','E',U8_EE+1,'E','I','I','I','I',
+   'D','N','O','O',U8_OO+1,'O','O','x','O','U','U','U','U','Y','?','s',
+   // U+00E0 Latin-1 lower case
+   'a','a',U8_AA,'a','a','a','a','c','e','e',U8_EE,'e','i','i','i','i',
+   'd','n','o','o',U8_OO,'o','o','/','o','u','u','u','u','y','?','y',
+   // U+0102 U+0110 U+0128 U+0168 U+01A0 pairs, U+01AF U+01B0
+   U8_AW+1, U8_DD+1, 'I', 'U', U8_OW+1, U8_UW+1, U8_UW,
+   // U+1EA0 Vietnamese pairs: A with dot below ... y with tilde
+   'A','A',U8_AA+1,U8_AA+1,U8_AA+1,U8_AA+1,U8_AA+1,
+   U8_AW+1,U8_AW+1,U8_AW+1,U8_AW+1,U8_AW+1,
+   'E','E','E',U8_EE+1,U8_EE+1,U8_EE+1,U8_EE+1,U8_EE+1,'I','I',
+   'O','O',U8_OO+1,U8_OO+1,U8_OO+1,U8_OO+1,U8_OO+1,
+   U8_OW+1,U8_OW+1,U8_OW+1,U8_OW+1,U8_OW+1,
+   'U','U',U8_UW+1,U8_UW+1,U8_UW+1,U8_UW+1,U8_UW+1,'Y','Y','Y','Y'};
+
+// Plain letters for U8_AW .. U8_UW+1
+char const UTF8_PLAIN[14] = {'a','A','a','A','d','D','e','E','o','O','o','O',
+                             'u','U'};
+
+#ifdef UTF8_CGRAM
+// CGRAM character for U8_AW .. U8_UW+1, or 0xFF for the plain letter
+BYTE const UTF8_SLOT[14] = {0,0xFF,1,0xFF,2,7,3,0xFF,4,0xFF,5,0xFF,6,0xFF};
+
+// 5x8 glyphs for CGRAM characters 0-7
+BYTE const UTF8_GLYPH[64] = {
+   0x11,0x0E,0x00,0x0E,0x01,0x0F,0x11,0x0F,     // a-breve
+   0x04,0x0A,0x00,0x0E,0x01,0x0F,0x11,0x0F,     // a-circumflex
+   0x02,0x07,0x02,0x0E,0x12,0x12,0x12,0x0E,     // d-stroke
+   0x04,0x0A,0x00,0x0E,0x11,0x1F,0x10,0x0E,     // e-circumflex
+   0x04,0x0A,0x00,0x0E,0x11,0x11,0x11,0x0E,     // o-circumflex
+   0x00,0x00,0x01,0x0F,0x11,0x11,0x11,0x0E,     // o-horn
+   0x00,0x00,0x01,0x13,0x11,0x11,0x13,0x0D,     // u-horn
+   0x0E,0x09,0x09,0x1D,0x09,0x09,0x0E,0x00};    // D-stroke
+#endif
+
+int16 utf8_cp;                      // code point so far, 0xFFFF outside BMP
+BYTE utf8_need = 0;                 // continuation bytes still to come
+
+void utf8_init(void)
+{
+#ifdef UTF8_CGRAM
+   BYTE i;
+
+   lcd_send_byte(0,0x40);           // CGRAM address 0
+   for(i=0;i<64;++i)
+      lcd_send_byte(1,UTF8_GLYPH[i]);
+   lcd_gotoxy(1,1);                 // back to DDRAM
+#endif
+   utf8_need = 0;
+}
+
+// Letter to show for code point cp, 0 for none
+BYTE utf8_fold(int16 cp)
+{
+   BYTE r, n, c;
+   int16 off;
+
+   for(r=0;r<UTF8_RANGES;++r)
+   {
+      off = cp - UTF8_FIRST[r];
+      n = UTF8_COUNT[r];
+      if(off >= (n & 0x7F))
+         continue;
+      if(bit_test(n,7))
+      {
+         c = UTF8_FOLD[UTF8_AT[r] + (make8(off,0) >> 1)];
+         if(bit_test(make8(off,0),0))   // odd: lower case
+            c = (c & 0x80) ? c - 1 : c | 0x20;
+         return(c);
+      }
+      return(UTF8_FOLD[UTF8_AT[r] + make8(off,0)]);
+   }
+   if(cp >= 0x0300 && cp < 0x0370)      // combining marks
+      return(0);
+   return('?');
+}
+
+void utf8_putc(BYTE b)
+{
+   BYTE c;
+
+   if(b < 0x80)
+   {
+      if(utf8_need)                     // cut short
+         lcd_putc('?');
+      utf8_need = 0;
+      lcd_putc(b);
+      return;
+   }
+   if(b < 0xC0)
+   {
+      if(!utf8_need)                    // stray continuation
+         return;
+      if(utf8_cp != 0xFFFF)
+         utf8_cp = (utf8_cp << 6) | (b & 0x3F);
+      if(--utf8_need)
+         return;
+      c = utf8_fold(utf8_cp);
+      if(c < 0x80)
+      {
+         if(c)
+            lcd_putc(c);
+         return;
+      }
+      c -= U8_AW;
+#ifdef UTF8_CGRAM
+      if(UTF8_SLOT[c] != 0xFF)
+      {
+         lcd_putc(UTF8_SLOT[c]);        // CGRAM character 0-7
+         return;
+      }
+#endif
+      lcd_putc(UTF8_PLAIN[c]);
+      return;
+   }
+   if(utf8_need)
+      lcd_putc('?');
+   if(b < 0xE0)
+   {
+      utf8_cp = b & 0x1F;
+      utf8_need = 1;
+   }
+   else if(b < 0xF0)
+   {
+      utf8_cp = b & 0x0F;
+      utf8_need = 2;
+   }
+   else
+   {
+      utf8_cp = 0xFFFF;
+      utf8_need = 3;
+   }
+}
@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+"""Worst-case execution time report from the CCS compiler listing.
+
+Reads code1.lst (build with the listing on) and the budgets in wcet.txt,
+and prints a bound in cycles and milliseconds for every function and for
+every control path named in wcet.txt.  Exits 1 if a path is over budget
+or a loop on it has no bound.
+
+The bound of a function is the sum of all its instructions, as if every
+branch were taken both ways, with each call costing the callee's bound.
+Cycles are the PIC16 ones: 1 per instruction, 2 for GOTO, CALL, RETURN,
+RETLW, RETFIE, a write to PCL, and for a skip (counted as taken).  A run
+of RETLW (a constant table) costs one return.
+
+A loop is a backward GOTO inside a function.  Its iteration bound is, in
+order:
+
+    // @wcet N          on the loop's first or last source line; N may
+                        use #define names and arithmetic, and a reason
+                        may follow a colon
+    // @wcet N total    as above, but N counts iterations per call of the
+                        function, not per pass of the enclosing loop
+    for(i=A; i<B; ...)  inferred from a constant A and B
+
+Code the compiler generates for a #use line gets 32 per loop.  Calls to
+delay_ms()/delay_us() with a constant cost that delay.  Interrupt time is
+not included in a path; the ISR bounds are listed on their own.
+
+wcet.txt lines:
+
+    clock  HZ                       oscillator, default 20000000
+    define NAME VALUE               for names the sources do not define
+    bound  FUNCTION CYCLES [PATH...]
+                                    for code with no source, e.g. library,
+                                    or a tighter bound than the listing
+                                    gives, on the named paths only
+    path   NAME BUDGET_MS FUNC...   one control path and its budget;
+                                    indented lines continue it
+
+usage: wcet.py [code1.lst] [wcet.txt] [--all]
+"""
+
+import argparse
+import glob
+import os
+import re
+import sys
+
+LIB_LOOP = 32
+TWO = {'GOTO', 'CALL', 'RETURN', 'RETLW', 'RETFIE'}
+SKIP = {'BTFSC', 'BTFSS', 'DECFSZ', 'INCFSZ'}
+KEYWORDS = {'if', 'else', 'while', 'for', 'do', 'switch', 'case', 'return',
+            'sizeof', 'goto'}
+
+ASM = re.compile(r'^([0-9A-F]{3,4}):\s+([A-Z]+)\s*([^\s;]*)')
+FUNC = re.compile(r'^[A-Za-z_][\w\s\*]*?\b([A-Za-z_]\w*)\s*\([^;]*$')
+FOR = re.compile(r'\bfor\s*\(\s*(?:\w+\s*=\s*(\w+))?[^;]*;'
+                 r'\s*\w+\s*(<=?)\s*([^;]+?)\s*;')
+
+
+class Unbounded(Exception):
+    pass
+
+
+class Insn:
+    def __init__(self, addr, op, arg, src):
+        self.addr, self.op, self.arg, self.src = addr, op, arg, src
+
+
+class Func:
+    def __init__(self, name, lib):
+        self.name, self.lib, self.code = name, lib, []
+
+
+class Loop:
+    def __init__(self, start, end, head, tail):
+        self.start, self.end = start, end
+        self.src = (head, tail)
+        self.inner, self.code = [], []
+
+
+def load_listing(path):
+    """Split the listing into functions, each with its instructions."""
+    funcs = [Func('<start>', True)]
+    src, fresh = [], True
+    for line in open(path, errors='replace'):
+        line = line.rstrip('\r\n')
+        if line.startswith('....................'):
+            text = line[20:]
+            if text.startswith(' '):
+                text = text[1:]
+            if not fresh:
+                src, fresh = [], True
+            src.append(text)
+            m = FUNC.match(text)
+            if m and m.group(1) not in KEYWORDS and text[0] != ' ':
+                funcs.append(Func(m.group(1), False))
+            elif text.startswith('#use'):
+                funcs.append(Func(text.strip(), True))
+            continue
+        m = ASM.match(line)
+        if m:
+            fresh = False
+            funcs[-1].code.append(Insn(int(m.group(1), 16), m.group(2),
+                                       m.group(3), '\n'.join(src)))
+    return [f for f in funcs if f.code]
+
+
+def load_defines(dirs, extra):
+    defs = {}
+    for d in dirs:
+        for p in glob.glob(os.path.join(d, '*.[ch]')):
+            for line in open(p, errors='replace'):
+                m = re.match(r'\s*#define\s+(\w+)\s+(.+)', line)
+                if not m or m.group(1) in defs:
+                    continue
+                v = re.sub(r'//.*|/\*.*?(\*/|$)', ' ', m.group(2)).strip()
+                if v:
+                    defs[m.group(1)] = v
+    defs.update(extra)
+    return defs
+
+
+def value(expr, defs, depth=0):
+    """Evaluate a bound such as 64 or RC522_WAIT+260."""
+    if depth > 16:
+        raise Unbounded('cannot evaluate %s' % expr)
+
+    def name(m):
+        w = m.group(0)
+        if w not in defs:
+            raise Unbounded('%s is not defined' % w)
+        return '(%d)' % value(defs[w], defs, depth + 1)
+    text = re.sub(r'0[xX][0-9A-Fa-f]+', lambda m: str(int(m.group(0), 16)),
+                  expr)
+    text = re.sub(r'\b[A-Za-z_]\w*\b', name, text)
+    if not re.match(r'^[\d\s()+\-*/<>]+$', text):
+        raise Unbounded('cannot evaluate %s' % expr)
+    try:
+        return int(eval(text.replace('/', '//')))
+    except (SyntaxError, ArithmeticError, TypeError, ValueError):
+        raise Unbounded('cannot evaluate %s' % expr)
+
+
+class Wcet:
+    def __init__(self, funcs, defs, bounds, clock):
+        self.funcs, self.defs, self.bounds = funcs, defs, bounds
+        self.cyc_ms = clock // 4 // 1000
+        self.at = {}
+        for f in funcs:
+            for i in f.code:
+                self.at[i.addr] = f
+        self.memo, self.busy = {}, set()
+
+    def cycles(self, i):
+        if i.op in TWO or i.op in SKIP:
+            return 2
+        if i.op in ('MOVWF', 'ADDWF', 'CLRF') and \
+                re.match(r'0?2(,F)?$', i.arg):
+            return 2
+        return 1
+
+    def delay(self, src):
+        m = re.search(r'delay_(ms|us)\s*\(\s*(\w+)\s*\)', src)
+        if not m:
+            return None
+        n = value(m.group(2), self.defs) * self.cyc_ms
+        return n if m.group(1) == 'ms' else n // 1000
+
+    def func(self, f):
+        if f.name in self.bounds:
+            return self.bounds[f.name]
+        if f.name in self.memo:
+            return self.memo[f.name]
+        if f.name in self.busy:
+            raise Unbounded('%s is recursive' % f.name)
+        self.busy.add(f.name)
+        try:
+            totals = []
+            top = self.loops(f)
+            n = self.block(f, top, totals) + sum(totals)
+        finally:
+            self.busy.discard(f.name)
+        self.memo[f.name] = n
+        return n
+
+    def loops(self, f):
+        """Nest the backward jumps of f into a loop tree."""
+        mine = set(i.addr for i in f.code)
+        ends = {}
+        for i in f.code:
+            if i.op != 'GOTO':
+                continue
+            t = int(i.arg, 16)
+            if t <= i.addr and t in mine:
+                if t not in ends or ends[t][0] < i.addr:
+                    ends[t] = (i.addr, i.src)
+        src = dict((i.addr, i.src) for i in f.code)
+        loops = sorted((Loop(t, e, src[t], s)
+                        for t, (e, s) in ends.items()),
+                       key=lambda l: (l.start, -l.end))
+        top = Loop(-1, 1 << 16, '', '')
+        stack = [top]
+        for l in loops:
+            while l.start > stack[-1].end:
+                stack.pop()
+            if l.end > stack[-1].end:
+                raise Unbounded('%s: loops at %04X and %04X overlap'
+                                % (f.name, stack[-1].start, l.start))
+            stack[-1].inner.append(l)
+            stack.append(l)
+        for i in f.code:
+            l = top
+            while True:
+                for k in l.inner:
+                    if k.start <= i.addr <= k.end:
+                        l = k
+                        break
+                else:
+                    break
+            l.code.append(i)
+        return top
+
+    def bound(self, f, l):
+        for src in l.src:
+            m = re.search(r'@wcet\s+([^:\n]+?)(\s+total)?\s*(:.*)?$',
+                          src, re.M)
+            if m:
+                return value(m.group(1), self.defs), bool(m.group(2))
+        m = FOR.search(l.src[0])
+        if m:
+            try:
+                n = value(m.group(3), self.defs) + (m.group(2) == '<=')
+                if m.group(1):
+                    n -= value(m.group(1), self.defs)
+                return max(n, 0), False
+            except Unbounded:
+                pass
+        if f.lib:
+            return LIB_LOOP, False
+        line = l.src[0].strip().split('\n')[-1]
+        raise Unbounded('%s: loop at %04X has no bound (%s)'
+                        % (f.name, l.start, line[:60]))
+
+    def block(self, f, l, totals):
+        n, table = 0, False
+        for i in l.code:
+            if i.op == 'RETLW':
+                n += 0 if table else 2
+                table = True
+                continue
+            table = False
+            n += self.cycles(i)
+            if i.op == 'CALL' or (i.op == 'GOTO' and i.arg):
+                t = int(i.arg, 16)
+                g = self.at.get(t)
+                if g is f or g is None:
+                    continue
+                d = self.delay(i.src) if g.name.startswith('#use delay') \
+                    else None
+                if d is not None:
+                    n += d
+                elif g.name.startswith('#use delay'):
+                    raise Unbounded('%s: delay at %04X is not constant'
+                                    % (f.name, i.addr))
+                else:
+                    n += self.func(g)
+        for k in l.inner:
+            times, total = self.bound(f, k)
+            body = self.block(f, k, totals)
+            if total:
+                totals.append(times * body)
+            else:
+                n += times * body
+        return n
+
+
+def load_budgets(path):
+    clock, defs, bounds, paths = 20000000, {}, {}, []
+    scoped = []
+    for n, line in enumerate(open(path), 1):
+        f = line.split('#')[0].split()
+        if not f:
+            continue
+        if line[0].isspace() and paths:
+            paths[-1][2].extend(f)
+        elif f[0] == 'clock' and len(f) == 2:
+            clock = int(f[1])
+        elif f[0] == 'define' and len(f) >= 3:
+            defs[f[1]] = ' '.join(f[2:])
+        elif f[0] == 'bound' and len(f) == 3 and f[2].isdigit():
+            bounds[f[1]] = int(f[2])
+        elif f[0] == 'bound' and len(f) > 3 and f[2].isdigit():
+            scoped.append((n, f[1], int(f[2]), f[3:]))
+        elif f[0] == 'path' and len(f) >= 4:
+            paths.append((f[1], float(f[2]), f[3:]))
+        else:
+            sys.exit('%s:%d: cannot parse' % (path, n))
+    names = [p[0] for p in paths]
+    local = dict((p, {}) for p in names)
+    for n, fn, c, on in scoped:
+        for p in on:
+            if p not in local:
+                sys.exit('%s:%d: no path %s' % (path, n, p))
+            local[p][fn] = c
+    return clock, defs, bounds, local, paths
+
+
+def main():
+    ap = argparse.ArgumentParser(description='worst-case execution times')
+    ap.add_argument('listing', nargs='?', default='code1.lst')
+    ap.add_argument('budgets', nargs='?', default='wcet.txt')
+    ap.add_argument('--all', action='store_true',
+                    help='list every function, not just ISRs and paths')
+    a = ap.parse_args()
+
+    clock, extra, bounds, local, paths = load_budgets(a.budgets)
+    here = os.path.dirname(os.path.abspath(a.listing))
+    funcs = load_listing(a.listing)
+    defs = load_defines([here, os.path.dirname(os.path.abspath(__file__))],
+                        extra)
+    w = Wcet(funcs, defs, bounds, clock)
+    ms = lambda c: c / w.cyc_ms
+    byname = dict((f.name, f) for f in funcs)
+
+    isr = set()
+    for f in funcs:
+        src = f.code[0].src if f.code else ''
+        if f.name.startswith('NGAT') or re.search(r'#int_\w+', src):
+            isr.add(f.name)
+    show = [f for f in funcs if a.all or f.name in isr]
+    if show:
+        print('%-24s %10s %9s' % ('function', 'cycles', 'ms'))
+    for f in show:
+        try:
+            c = w.func(f)
+            print('%-24s %10d %9.3f%s' % (f.name, c, ms(c),
+                                          '  (isr)' if f.name in isr else ''))
+        except Unbounded as e:
+            print('%-24s %10s %9s  %s' % (f.name, '-', '-', e))
+
+    bad = 0
+    print('\n%-8s %10s %9s %9s' % ('path', 'cycles', 'ms', 'budget'))
+    for name, budget, chain in paths:
+        on = dict(bounds, **local[name])
+        pw = Wcet(funcs, defs, on, clock) if local[name] else w
+        try:
+            c = 0
+            for fn in chain:
+                if fn not in byname and fn not in on:
+                    raise Unbounded('%s not in the listing' % fn)
+                c += on[fn] if fn in on else pw.func(byname[fn])
+        except Unbounded as e:
+            print('%-8s %10s %9s %9.1f  %s' % (name, '-', '-', budget, e))
+            bad += 1
+            continue
+        over = ms(c) > budget
+        bad += over
+        print('%-8s %10d %9.3f %9.1f%s' % (name, c, ms(c), budget,
+                                           '  OVER' if over else ''))
+    sys.exit(1 if bad else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////
+////                            WIEGAND.C                              ////
+////             Wiegand 26/34 output to legacy access panels          ////
+////                                                                   ////
+////  wg_init()          Idle both lines high and set up Timer0.       ////
+////                                                                   ////
+////  wg_send(data,n)    Queue an n bit frame (26 or 34) carrying the  ////
+////                     first n-2 bits of data, MSB first, with       ////
+////                     leading even and trailing odd parity.         ////
+////                     Returns FALSE while a frame is still going    ////
+////                     out.  The pulses are generated by the Timer0  ////
+////                     interrupt, so the main loop does not wait.    ////
+////                                                                   ////
+////  Timing (20 MHz, Timer0 at 1.6 us per count): 50 us low pulse on  ////
+////  D0 for a 0 or D1 for a 1, then 1.6 ms before the next bit.       ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef WG_D0
+   #define WG_D0       PIN_E0
+   #define WG_D1       PIN_E1
+#endif
+
+#define WG_PULSE       31          // counts in the 50us pulse
+#define WG_SLICE       250         // counts per 400us gap slice
+#define WG_SLICES      4           // 1.6ms between pulses
+
+BYTE wg_bits[5];                    // frame, first bit in bit 0 of byte 0
+BYTE wg_left = 0;                   // bits still to send
+BYTE wg_gap = 0;                    // gap slices still to wait
+int1 wg_low = 0;                    // a pulse is being driven
+
+#ifdef __PCM__
+#int_rtcc
+#endif
+void wg_isr(void)
+{
+   ISR_ENTER();
+   ISR_WAIT(ISR_RTCC, (int16)get_timer0()*8);     // 1.6us counts since the overflow
+   if(wg_low)
+   {
+      output_high(WG_D0);
+      output_high(WG_D1);
+      wg_low = 0;
+      wg_gap = WG_SLICES;
+      set_timer0(256-WG_SLICE);
+   }
+   else if(wg_gap && --wg_gap)
+   {
+      set_timer0(256-WG_SLICE);
+   }
+   else if(!wg_left)
+   {
+      disable_interrupts(INT_RTCC);
+   }
+   else
+   {
+      --wg_left;
+      if(shift_right(wg_bits, 5, 0))
+         output_low(WG_D1);
+      else
+         output_low(WG_D0);
+      wg_low = 1;
+      set_timer0(256-WG_PULSE);
+   }
+   ISR_LEAVE(ISR_RTCC);
+}
+
+void wg_init(void)
+{
+   output_high(WG_D0);
+   output_high(WG_D1);
+   setup_timer_0(RTCC_INTERNAL|RTCC_DIV_8);
+}
+
+int1 wg_send(char data[], BYTE n)
+{
+   BYTE i, half;
+   int1 even = 0, odd = 1;
+
+   if(wg_left || wg_low || wg_gap)
+      return(FALSE);
+
+   for(i=0;i<5;++i)
+      wg_bits[i] = 0;
+   n -= 2;
+   half = n >> 1;
+   for(i=0;i<n;++i)                 // @wcet 34
+   {
+      if(!bit_test(data[i>>3], 7-(i&7)))
+         continue;
+      bit_set(wg_bits[(i+1)>>3], (i+1)&7);
+      if(i < half)
+         even ^= 1;
+      else
+         odd ^= 1;
+   }
+   if(even)
+      bit_set(wg_bits[0], 0);
+   if(odd)
+      bit_set(wg_bits[(n+1)>>3], (n+1)&7);
+
+   wg_left = n+2;
+   set_timer0(255);                  // first pulse on the next count
+   clear_interrupt(INT_RTCC);
+   enable_interrupts(INT_RTCC);
+   return(TRUE);
+}
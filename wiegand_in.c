@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////
+////                          WIEGAND_IN.C                             ////
+////           Wiegand 26/34 capture from third-party readers          ////
+////                                                                   ////
+////  wgi_init()        Enable pull-ups and interrupt-on-change on     ////
+////                    the two PORTB data lines.                      ////
+////                                                                   ////
+////  wgi_frame(uid)    TRUE when a complete frame with good parity    ////
+////                    has arrived; uid receives 4 bytes.  A frame    ////
+////                    ends when no bit arrived for WGI_GAP_MS.  A    ////
+////                    W26 frame's 24 data bits land in uid[0..2]     ////
+////                    with uid[3] = 0, the bytes wg_send() takes     ////
+////                    them from.                                     ////
+////                                                                   ////
+////  The interrupt only shifts one bit into a 5 byte buffer and       ////
+////  stamps the time; framing and parity are checked from the main    ////
+////  loop.  Needs tick.c.                                             ////
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef WGI_D0_BIT
+   #define WGI_D0_BIT     4         // RB4
+   #define WGI_D1_BIT     5         // RB5
+#endif
+#ifndef WGI_GAP_MS
+   #define WGI_GAP_MS     20        // silence that ends a frame
+#endif
+
+#ifdef __PCM__
+#byte WGI_PORT = getenv("SFR:PORTB")
+#else
+#define WGI_PORT PORTB
+#endif
+
+BYTE wgi_bits[5];                   // last bit received in bit 0 of byte 0
+BYTE wgi_n = 0;                     // bits received
+BYTE wgi_last;                      // PORTB at the previous edge
+int16 wgi_t;                        // tick of the last bit
+
+#ifdef __PCM__
+#int_rb
+#endif
+void wgi_isr(void)
+{
+   BYTE now, fall;
+
+   ISR_ENTER();
+   now = WGI_PORT;                   // reading PORTB ends the mismatch
+   fall = wgi_last & ~now;
+   wgi_last = now;
+   if(wgi_n < 40 && (fall & ((1 << WGI_D0_BIT) | (1 << WGI_D1_BIT))))
+   {
+      shift_left(wgi_bits, 5, !bit_test(fall, WGI_D0_BIT));
+      ++wgi_n;
+      wgi_t = tick_ms;
+   }
+   ISR_LEAVE(ISR_RB);
+}
+
+void wgi_init(void)
+{
+   port_b_pullups((1 << WGI_D0_BIT) | (1 << WGI_D1_BIT));
+   wgi_last = WGI_PORT;
+   clear_interrupt(INT_RB);
+   enable_interrupts(INT_RB4);
+   enable_interrupts(INT_RB5);
+}
+
+// frame bit k counted from the first bit received
+int1 wgi_bit(BYTE n, BYTE k)
+{
+   k = n-1-k;
+   return(bit_test(wgi_bits[k>>3], k&7));
+}
+
+int1 wgi_frame(char uid[])
+{
+   BYTE n, i, half, ones;
+
+   disable_interrupts(INT_RB);
+   n = wgi_n;
+   if(n == 0 || tick_since(wgi_t) < WGI_GAP_MS)
+   {
+      enable_interrupts(INT_RB);
+      return(FALSE);
+   }
+   wgi_n = 0;
+   enable_interrupts(INT_RB);
+
+   if(n != 26 && n != 34)
+      return(FALSE);
+   half = (n >> 1) - 1;
+
+   // even parity over the first half, odd over the second
+   ones = 0;
+   for(i=0;i<=half;++i)             // @wcet 17
+      ones += wgi_bit(n, i);
+   if(ones & 1)
+      return(FALSE);
+   ones = 0;
+   for(;i<n;++i)                    // @wcet 34
+      ones += wgi_bit(n, i);
+   if(!(ones & 1))
+      return(FALSE);
+
+   for(i=0;i<4;++i)
+      uid[i] = 0;
+   for(i=0;i<n-2;++i)               // @wcet 32
+      if(wgi_bit(n, i+1))
+         bit_set(uid[i>>3], 7-(i&7));
+   return(TRUE);
+}